@@ -1,4 +1,7 @@
 #include "bsp_uart.h"
+#include "bsp_uart_dma.h"
+#include "hal_rng.h"
+#include "critical.h"
 
 
 
@@ -50,6 +53,22 @@
 UART_T g_tUart1;
 uint8_t g_TxBuf1[UART1_TX_BUF_SIZE]; /* 发送缓冲区 */
 uint8_t g_RxBuf1[UART1_RX_BUF_SIZE]; /* 接收缓冲区 */
+
+/* DMA发送队列：g_TxBuf1作为ring，DMA直接从ring中取数据，当前只发送ring中第一段连续的数据，
+   发送完成中断中释放这一段并启动下一段 */
+static T_Ring s_tTx1Ring;
+static RING_ID s_tx1 = 0;
+static volatile uint16_t s_tx1_inflight = 0;    /* 正在由DMA发送的字节数，0表示DMA空闲 */
+static UART_TX_STATS s_tx1_stats;
+
+/* 循环DMA接收：DMA不停地写g_RxBuf1，空闲线路/半传输/传输完成时从软件读索引处理到DMA写位置。
+   DMA已写总字节数 = s_rx1_lap_base + (缓冲区大小 - CNDTR)，与已处理总字节数相减得到未处理的字节数 */
+static uint16_t s_rx1_read = 0;                 /* 已交给处理函数的位置 */
+static uint32_t s_rx1_lap_base = 0;             /* 已完成的整圈对应的字节数，每次TC加缓冲区大小 */
+static uint32_t s_rx1_done = 0;                 /* 已处理(交付或因溢出丢弃)的总字节数 */
+static UART_RX_HANDLER s_rx1_handler = 0;
+static UART_RX_STATS s_rx1_stats;
+static UartFrameDec_t s_rx1_frame;              /* 帧解码器，直接解析g_RxBuf1 */
 #endif
 
 #if UART2_FIFO_EN == 1
@@ -80,7 +99,10 @@ void RS485_SendOver()
 
 void UART1_RevCallBack(uint8_t  byte)
 {
-	if(byte == 0x55 && (g_tUart1.pRxBuf[g_tUart1.usRxWrite-3] == 0xAA))
+	/* usRxWrite已指向当前字节之后，往回数时按缓冲区大小回绕，避免下标为负 */
+	uint16_t idx = (uint16_t)((g_tUart1.usRxWrite + g_tUart1.usRxBufSize - 3) % g_tUart1.usRxBufSize);
+
+	if(byte == 0x55 && (g_tUart1.pRxBuf[idx] == 0xAA))
 	{
 		g_tUart1.usRxFlag = 1;
 	}
@@ -113,6 +135,13 @@ static void UartVarInit(void)
     g_tUart1.SendOver = RS485_SendOver;                     /* 发送完毕后的回调函数 */
     g_tUart1.ReciveNew = UART1_RevCallBack;                 /* 接收到新数据后的回调函数 */
     g_tUart1.Sending = 0;                                   /* 正在发送中标志 */
+    s_tx1 = rngInit(&s_tTx1Ring, (char *)g_TxBuf1, UART1_TX_BUF_SIZE);
+    s_tx1_inflight = 0;
+    memset(&s_tx1_stats, 0, sizeof(s_tx1_stats));
+    s_rx1_read = 0;
+    s_rx1_lap_base = 0;
+    s_rx1_done = 0;
+    memset(&s_rx1_stats, 0, sizeof(s_rx1_stats));
 #endif
 
 #if UART2_FIFO_EN == 1
@@ -238,7 +267,7 @@ static void InitHardUart()
     DMA_RxInitStructure.DMA_MemoryInc =DMA_MemoryInc_Enable;
     DMA_RxInitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
     DMA_RxInitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
-    DMA_RxInitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_RxInitStructure.DMA_Mode = DMA_Mode_Circular; /*循环模式，缓冲区写满后从头继续接收*/
     DMA_RxInitStructure.DMA_Priority = DMA_Priority_High;
     DMA_RxInitStructure.DMA_M2M = DMA_M2M_Disable;
     DMA_Init(DMA1_Channel5,&DMA_RxInitStructure);
@@ -257,8 +286,8 @@ static void InitHardUart()
 
 	DMA_Cmd(DMA1_Channel4,DISABLE);
     DMA_Cmd(DMA1_Channel5,ENABLE);
-    //DMA_ITConfig(DMA1_Channel4,DMA_IT_TC,ENABLE);
-    DMA_ITConfig(DMA1_Channel5,DMA_IT_TC,ENABLE); /*开启传输完成中断*/
+    DMA_ITConfig(DMA1_Channel4,DMA_IT_TC,ENABLE); /*发送完成中断中启动下一段*/
+    DMA_ITConfig(DMA1_Channel5,DMA_IT_HT | DMA_IT_TC,ENABLE); /*半传输和传输完成中断，每半个缓冲区至少处理一次*/
 
 #endif
 }
@@ -301,6 +330,7 @@ UART_T *ComToUart(COM_PORT_E _ucPort)
 
 
 
+#if UART2_FIFO_EN == 1 || UART3_FIFO_EN == 1      /* USART1收发都走DMA，不经过这里 */
 /*
 *********************************************************************************************************
 *    函 数 名: UartIRQ
@@ -360,45 +390,397 @@ static void UartIRQ(UART_T *_pUart)
 
     // F1标准库下，错误标志通过读SR/DR自动清除，无需手动清ICR
 }
+#endif
 
-void Uart1_SendDMA(uint8_t *buf, uint16_t len)
+#if UART1_FIFO_EN == 1
+/*
+*********************************************************************************************************
+*    函 数 名: Uart1_TxKick
+*    功能说明: DMA空闲且队列中有数据时，启动发送ring中第一段连续的数据，需在临界区或DMA中断中调用
+*    形    参: 无
+*    返 回 值: 无
+*********************************************************************************************************
+*/
+static void Uart1_TxKick(void)
 {
+    char *p;
+    int len;
+
+    if (s_tx1_inflight != 0 || s_tx1 == 0)
+    {
+        return;
+    }
+    if (rngGetRegions(s_tx1, &p, &len, NULL, NULL) == 0)
+    {
+        return;
+    }
 
+    s_tx1_inflight = (uint16_t)len;
+    g_tUart1.Sending = 1;
     DMA_Cmd(DMA1_Channel4, DISABLE);
+    DMA1_Channel4->CMAR = (uint32_t)p;
+    DMA_SetCurrDataCounter(DMA1_Channel4, (uint16_t)len);
+    DMA_Cmd(DMA1_Channel4, ENABLE);
+}
 
-    /*设置内存地址和数据长度*/ 
-    DMA1_Channel4->CMAR = (uint32_t)buf;
-    DMA_SetCurrDataCounter(DMA1_Channel4, len);
+/*
+*********************************************************************************************************
+*    函 数 名: Uart1_Write
+*    功能说明: 把数据写入DMA发送队列后立即返回，DMA空闲时启动发送，不会打断正在进行的传输。
+*              空间不足时整条丢弃，避免输出半条日志
+*    形    参: buf : 数据
+*              len : 长度
+*    返 回 值: 写入的字节数，0表示丢弃
+*********************************************************************************************************
+*/
+int Uart1_Write(const uint8_t *buf, uint16_t len)
+{
+    int ret = 0;
+    uint32_t pm;
 
-    /*使能DMA发送*/ 
-    DMA_Cmd(DMA1_Channel4, ENABLE);
+    if (buf == 0 || len == 0)
+    {
+        return 0;
+    }
+
+    pm = Critical_Enter();
+    if (s_tx1 != 0 && UART1_TX_BUF_SIZE - 1 - rngLen(s_tx1) >= len)
+    {
+        ret = rngBufPut(s_tx1, (char *)buf, len);
+        s_tx1_stats.queued += ret;
+        Uart1_TxKick();
+    }
+    else
+    {
+        s_tx1_stats.dropped += len;
+    }
+    Critical_Exit(pm);
+    return ret;
+}
+
+/*
+*********************************************************************************************************
+*    函 数 名: Uart1_SendDMA
+*    功能说明: 通过DMA发送一段数据。数据先拷贝进发送队列再排队发送，buf在返回后即可复用
+*    形    参: buf : 数据
+*              len : 长度
+*    返 回 值: 无
+*********************************************************************************************************
+*/
+void Uart1_SendDMA(uint8_t *buf, uint16_t len)
+{
+    Uart1_Write(buf, len);
+}
+
+/*
+*********************************************************************************************************
+*    函 数 名: Uart1_TxPending
+*    功能说明: 获取发送队列中尚未发送完成的字节数(含正在发送的一段)，可用于复位前等待日志发完
+*    形    参: 无
+*    返 回 值: 字节数
+*********************************************************************************************************
+*/
+int Uart1_TxPending(void)
+{
+    return (s_tx1 == 0) ? 0 : rngLen(s_tx1);
+}
+
+/*
+*********************************************************************************************************
+*    函 数 名: Uart1_GetTxStats
+*    功能说明: 获取DMA发送统计
+*    形    参: out : 输出统计
+*    返 回 值: 无
+*********************************************************************************************************
+*/
+void Uart1_GetTxStats(UART_TX_STATS *out)
+{
+    uint32_t pm = Critical_Enter();
+    *out = s_tx1_stats;
+    Critical_Exit(pm);
+}
+
+/*
+*********************************************************************************************************
+*    函 数 名: DMA1_Channel4_IRQHandler
+*    功能说明: USART1 DMA发送完成中断，释放已发送的一段并启动下一段(包括ring回绕后的第二段)
+*    形    参: 无
+*    返 回 值: 无
+*********************************************************************************************************
+*/
+void DMA1_Channel4_IRQHandler(void)
+{
+    if (DMA_GetITStatus(DMA1_IT_TC4) != RESET)
+    {
+        DMA_ClearITPendingBit(DMA1_IT_TC4);
+        DMA_Cmd(DMA1_Channel4, DISABLE);
+
+        rngConsume(s_tx1, s_tx1_inflight);
+        s_tx1_stats.sent += s_tx1_inflight;
+        s_tx1_inflight = 0;
+        Uart1_TxKick();
+        if (s_tx1_inflight == 0)
+        {
+            g_tUart1.Sending = 0;
+        }
+    }
+}
+
+/*
+*********************************************************************************************************
+*    函 数 名: Uart1_RxDeliver
+*    功能说明: 把一段连续的接收数据交给处理函数，未设置处理函数时按原方式逐字节调用ReciveNew
+*    形    参: data : 数据，位于g_RxBuf1内
+*              len : 长度
+*    返 回 值: 无
+*********************************************************************************************************
+*/
+static void Uart1_RxDeliver(const uint8_t *data, uint16_t len)
+{
+    uint16_t i;
+
+    s_rx1_stats.bytes += len;
+    s_rx1_stats.chunks++;
+    if (s_rx1_handler != 0)
+    {
+        s_rx1_handler(data, len);
+        return;
+    }
+
+    for (i = 0; i < len; i++)
+    {
+        g_tUart1.usRxWrite = (uint16_t)(data + i + 1 - g_RxBuf1);
+        if (g_tUart1.usRxWrite >= UART1_RX_BUF_SIZE)
+        {
+            g_tUart1.usRxWrite = 0;
+        }
+        if (g_tUart1.usRxCount < UART1_RX_BUF_SIZE)
+        {
+            g_tUart1.usRxCount++;
+        }
+        if (g_tUart1.ReciveNew)
+        {
+            g_tUart1.ReciveNew(data[i]);
+        }
+    }
 }
 
+/*
+*********************************************************************************************************
+*    函 数 名: Uart1_RxWritten
+*    功能说明: 计算DMA已写入的总字节数。TC标志在这里消费并计入整圈，不论是哪个中断先看到回绕；
+*              前后两次读TC标志一致才采用CNDTR，保证CNDTR和整圈计数属于同一圈。TC标志只能记下一次
+*              回绕，两次处理之间DMA回绕两次(中断被屏蔽超过一圈)时少算一圈，HT/TC中断保证了正常情况下
+*              每半圈至少处理一次
+*    形    参: 无
+*    返 回 值: DMA已写入的总字节数(按32位回绕)
+*********************************************************************************************************
+*/
+static uint32_t Uart1_RxWritten(void)
+{
+    FlagStatus tc;
+    uint16_t ndtr;
+
+    do
+    {
+        tc = DMA_GetFlagStatus(DMA1_FLAG_TC5);
+        ndtr = DMA_GetCurrDataCounter(DMA1_Channel5);
+    } while (DMA_GetFlagStatus(DMA1_FLAG_TC5) != tc);
+
+    if (tc != RESET)
+    {
+        DMA_ClearFlag(DMA1_FLAG_TC5);
+        s_rx1_lap_base += UART1_RX_BUF_SIZE;
+        s_rx1_stats.tc_events++;
+    }
+    return s_rx1_lap_base + (uint32_t)(UART1_RX_BUF_SIZE - ndtr);
+}
+
+/*
+*********************************************************************************************************
+*    函 数 名: Uart1_RxProcess
+*    功能说明: 把上次处理之后DMA写入的数据交给处理函数，跨过缓冲区末尾时分两段交付。未处理的数据
+*              超过缓冲区大小说明DMA已经覆盖了其中一部分，整段丢弃并以(NULL, 0)通知处理函数重新同步。
+*              USART1和DMA1_Channel5中断优先级相同，不会互相嵌套
+*    形    参: 无
+*    返 回 值: 无
+*********************************************************************************************************
+*/
+static void Uart1_RxProcess(void)
+{
+    uint32_t lag = Uart1_RxWritten() - s_rx1_done;
+    uint16_t first;
+
+    if (lag == 0)
+    {
+        return;
+    }
+    if (lag > UART1_RX_BUF_SIZE)
+    {
+        s_rx1_stats.lap_overruns++;
+        s_rx1_stats.lost_bytes += lag;
+        s_rx1_done += lag;
+        s_rx1_read = (uint16_t)((s_rx1_read + lag) % UART1_RX_BUF_SIZE);
+        if (s_rx1_handler != 0)
+        {
+            s_rx1_handler(0, 0);
+        }
+        return;
+    }
+
+    first = UART1_RX_BUF_SIZE - s_rx1_read;
+    if (first >= lag)
+    {
+        Uart1_RxDeliver(&g_RxBuf1[s_rx1_read], (uint16_t)lag);
+    }
+    else
+    {
+        Uart1_RxDeliver(&g_RxBuf1[s_rx1_read], first);
+        Uart1_RxDeliver(&g_RxBuf1[0], (uint16_t)(lag - first));
+    }
+    s_rx1_done += lag;
+    s_rx1_read = (uint16_t)((s_rx1_read + lag) % UART1_RX_BUF_SIZE);
+}
+
+/*
+*********************************************************************************************************
+*    函 数 名: Uart1_SetRxHandler
+*    功能说明: 设置接收数据处理函数
+*    形    参: handler : 处理函数，NULL表示逐字节调用ReciveNew
+*    返 回 值: 无
+*********************************************************************************************************
+*/
+void Uart1_SetRxHandler(UART_RX_HANDLER handler)
+{
+    uint32_t pm = Critical_Enter();
+    s_rx1_handler = handler;
+    Critical_Exit(pm);
+}
+
+/*
+*********************************************************************************************************
+*    函 数 名: Uart1_GetRxStats
+*    功能说明: 获取DMA接收统计
+*    形    参: out : 输出统计
+*    返 回 值: 无
+*********************************************************************************************************
+*/
+void Uart1_GetRxStats(UART_RX_STATS *out)
+{
+    uint32_t pm = Critical_Enter();
+    *out = s_rx1_stats;
+    Critical_Exit(pm);
+}
+
+/*
+*********************************************************************************************************
+*    函 数 名: Uart1_FrameFeed
+*    功能说明: 接收数据处理函数，把DMA交付的数据段输入帧解码器
+*    形    参: data : 数据，位于g_RxBuf1内
+*              len : 长度
+*    返 回 值: 无
+*********************************************************************************************************
+*/
+static void Uart1_FrameFeed(const uint8_t *data, uint16_t len)
+{
+    if (data == 0)
+    {
+        UartFrame_Reset(&s_rx1_frame);          /* 接收溢出，丢弃未完成的帧 */
+        s_rx1_frame.stats.resyncs++;
+        return;
+    }
+    UartFrame_Feed(&s_rx1_frame, data, len);
+}
+
+/*
+*********************************************************************************************************
+*    函 数 名: Uart1_SetFrameHandler
+*    功能说明: 按帧接收：解码器直接解析DMA接收缓冲区，校验通过的帧在中断中交给handler，
+*              帧负载指向g_RxBuf1，handler返回后不再有效
+*    形    参: handler : 帧处理函数，NULL表示停止按帧接收，恢复逐字节调用ReciveNew
+*    返 回 值: 0 成功，-1 接收缓冲区太小
+*********************************************************************************************************
+*/
+int Uart1_SetFrameHandler(UartFrameHandler handler)
+{
+    int ret = 0;
+    uint32_t pm = Critical_Enter();
+
+    if (handler == 0)
+    {
+        s_rx1_handler = 0;
+    }
+    else if (UartFrame_Init(&s_rx1_frame, g_RxBuf1, UART1_RX_BUF_SIZE, s_rx1_read, handler) == 0)
+    {
+        s_rx1_handler = Uart1_FrameFeed;
+    }
+    else
+    {
+        ret = -1;
+    }
+    Critical_Exit(pm);
+    return ret;
+}
+
+/*
+*********************************************************************************************************
+*    函 数 名: Uart1_GetFrameStats
+*    功能说明: 获取帧解码统计
+*    形    参: out : 输出统计
+*    返 回 值: 无
+*********************************************************************************************************
+*/
+void Uart1_GetFrameStats(UartFrameStats_t *out)
+{
+    uint32_t pm = Critical_Enter();
+    *out = s_rx1_frame.stats;
+    Critical_Exit(pm);
+}
+
+/*
+*********************************************************************************************************
+*    函 数 名: DMA1_Channel5_IRQHandler
+*    功能说明: USART1 DMA接收半传输/传输完成中断
+*    形    参: 无
+*    返 回 值: 无
+*********************************************************************************************************
+*/
+void DMA1_Channel5_IRQHandler(void)
+{
+    if (DMA_GetITStatus(DMA1_IT_HT5) != RESET)
+    {
+        DMA_ClearITPendingBit(DMA1_IT_HT5);
+        s_rx1_stats.ht_events++;
+    }
+    Uart1_RxProcess();                          /* TC标志由Uart1_RxWritten读取并清除 */
+}
+#endif
+
+/*
+*********************************************************************************************************
+*    函 数 名: debug_printf
+*    功能说明: 格式化后写入USART1的DMA发送队列，不阻塞，队列满时丢弃整条
+*    形    参: fmt : 格式化字符串
+*    返 回 值: 无
+*********************************************************************************************************
+*/
 void debug_printf(char* fmt, ...) 
 {
-	UART_T *pUart = ComToUart(DEBUG_UART);
 	va_list ap;
 	va_start(ap, fmt);
 	char tempBuf[128];
 	int len = vsnprintf(tempBuf, sizeof(tempBuf), fmt, ap);
 	va_end(ap);
 
-	uint16_t firstPart = pUart->usTxBufSize - pUart->usTxWrite;
-	if (len <= firstPart) 
+	if (len <= 0)
 	{
-		memcpy(&pUart->pTxBuf[pUart->usTxWrite], tempBuf, len);
-	} 
-	else 
+		return;
+	}
+	if (len >= (int)sizeof(tempBuf))
 	{
-		memcpy(&pUart->pTxBuf[pUart->usTxWrite], tempBuf, firstPart);
-		memcpy(&pUart->pTxBuf[0], tempBuf + firstPart, len - firstPart);
+		len = sizeof(tempBuf) - 1; /* 超长时输出被截断的部分 */
 	}
-	
-	// 启动DMA发送（假设DMA空闲或由DMA中断续发）
-	Uart1_SendDMA(&pUart->pTxBuf[pUart->usTxRead], (len <= firstPart) ? len : firstPart);
-	
-	pUart->usTxWrite = (pUart->usTxWrite + len) % pUart->usTxBufSize;
-	pUart->usTxRead = (pUart->usTxRead + len) % pUart->usTxBufSize;
+	Uart1_Write((uint8_t *)tempBuf, (uint16_t)len);
 }
 
 /*
@@ -448,7 +830,26 @@ void bsp_InitUart(void)
 #if UART1_FIFO_EN == 1
 void USART1_IRQHandler(void)
 {
-    UartIRQ(&g_tUart1);
+    uint32_t sr = READ_REG(USART1->SR);
+
+    /* USART1接收走DMA，这里不读RXNE，只处理空闲线路和错误。先读SR再读DR清除IDLE/ORE/NE/FE */
+    if (sr & (USART_SR_IDLE | USART_SR_ORE | USART_SR_NE | USART_SR_FE))
+    {
+        (void)READ_REG(USART1->DR);
+        if (sr & USART_SR_ORE)
+        {
+            s_rx1_stats.ore_errors++;
+        }
+        if (sr & (USART_SR_NE | USART_SR_FE))
+        {
+            s_rx1_stats.line_errors++;
+        }
+        if (sr & USART_SR_IDLE)
+        {
+            s_rx1_stats.idle_events++;
+            Uart1_RxProcess();
+        }
+    }
 }
 #endif
 
@@ -0,0 +1,42 @@
+#ifndef __BSP_UART_DMA_H
+#define __BSP_UART_DMA_H
+
+#include <stdint.h>
+#include "uart_frame.h"
+
+/*USART1 DMA发送统计，单位字节*/
+typedef struct
+{
+	uint32_t queued;	/*写入发送队列*/
+	uint32_t sent;		/*DMA发送完成*/
+	uint32_t dropped;	/*队列空间不足被丢弃*/
+} UART_TX_STATS;
+
+/*USART1 DMA接收统计*/
+typedef struct
+{
+	uint32_t bytes;			/*收到的字节数*/
+	uint32_t chunks;		/*交给处理函数的连续数据段数*/
+	uint32_t idle_events;	/*空闲线路中断次数*/
+	uint32_t ht_events;		/*DMA半传输中断次数*/
+	uint32_t tc_events;		/*DMA传输完成中断次数*/
+	uint32_t ore_errors;	/*USART硬件溢出(ORE)次数*/
+	uint32_t line_errors;	/*噪声/帧错误次数*/
+	uint32_t lap_overruns;	/*未处理的数据超过缓冲区大小，已被DMA覆盖的次数*/
+	uint32_t lost_bytes;	/*因此丢弃的字节数*/
+} UART_RX_STATS;
+
+/*接收数据处理函数，在中断中调用，data指向g_RxBuf1内部，返回后该段可能被DMA覆盖。
+  data为NULL(len为0)表示接收溢出丢了数据，下一段与之前的数据不连续*/
+typedef void (*UART_RX_HANDLER)(const uint8_t *data, uint16_t len);
+
+int  Uart1_Write(const uint8_t *buf, uint16_t len);	/*非阻塞，整条写入返回len，空间不足返回0并计入dropped*/
+void Uart1_SendDMA(uint8_t *buf, uint16_t len);
+int  Uart1_TxPending(void);							/*尚未发送完成的字节数*/
+void Uart1_GetTxStats(UART_TX_STATS *out);
+void Uart1_SetRxHandler(UART_RX_HANDLER handler);		/*NULL:恢复默认，逐字节调用ReciveNew*/
+void Uart1_GetRxStats(UART_RX_STATS *out);
+int  Uart1_SetFrameHandler(UartFrameHandler handler);	/*按帧接收，见uart_frame.h，NULL:停止*/
+void Uart1_GetFrameStats(UartFrameStats_t *out);
+
+#endif
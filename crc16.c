@@ -0,0 +1,25 @@
+#include "crc16.h"
+
+const u16 g_crc16_ccitt_tab[16] =
+{
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/*
+***************************************************************************************
+* 函 数 名: Crc16_Calc
+* 功能说明: 计算CRC16-CCITT，可分段累加
+* 形   参: crc - 初值或上一段的结果；data - 数据；len - 长度
+* 返 回 值: CRC值
+***************************************************************************************
+*/
+u16 Crc16_Calc(u16 crc, const void *data, u32 len)
+{
+	const u8 *p = (const u8 *)data;
+	while (len--)
+	{
+		crc = Crc16_Byte(crc, *p++);
+	}
+	return crc;
+}
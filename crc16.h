@@ -0,0 +1,18 @@
+#ifndef __CRC16_H__
+#define __CRC16_H__
+
+#include "types.h"
+
+/*CRC16-CCITT(多项式0x1021)，半字节查表，每字节查两次16项的表，表只占32字节*/
+extern const u16 g_crc16_ccitt_tab[16];
+
+static inline u16 Crc16_Byte(u16 crc, u8 b)
+{
+	crc = (u16)((crc << 4) ^ g_crc16_ccitt_tab[(crc >> 12) ^ (b >> 4)]);
+	crc = (u16)((crc << 4) ^ g_crc16_ccitt_tab[(crc >> 12) ^ (b & 0x0FU)]);
+	return crc;
+}
+
+u16 Crc16_Calc(u16 crc, const void *data, u32 len);
+
+#endif
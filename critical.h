@@ -0,0 +1,28 @@
+#ifndef __CRITICAL_H__
+#define __CRITICAL_H__
+
+#include "stm32f10x.h"
+
+/*
+ * 临界区：短暂屏蔽中断(PRIMASK)，中断和主循环共享的数据结构在这里修改，例如
+ *     uint32_t pm = Critical_Enter();
+ *     ...
+ *     Critical_Exit(pm);
+ * 可以嵌套，退出时只有进入前原本开中断才恢复中断
+ */
+static inline uint32_t Critical_Enter(void)
+{
+	uint32_t pm = __get_PRIMASK();
+	__disable_irq();
+	return pm;
+}
+
+static inline void Critical_Exit(uint32_t pm)
+{
+	if ((pm & 1U) == 0U)
+	{
+		__enable_irq();
+	}
+}
+
+#endif
@@ -3,11 +3,13 @@
 *
 *   模块名称 : 错误码FIFO模块
 *   文件名称 : errcode_fifo.c
-*   版    本 : V1.0
+*   版    本 : V1.1
 *   说    明 : 实现错误日志存储的FIFO，尽量保证错误码不丢失
 *   修改记录 :
 *       版本号  	日期        作者     	说明
 *       V1.0    2025-09-4  汤金铖    	实现基本功能
+*       V1.1    2026-10-18 agent     	批量写Flash；去重索引和合并计数；紧凑存储布局；复位后保留(no-init RAM)；
+*                                    	按严重等级分队列和可选淘汰策略
 *
 *********************************************************************************************************
 */
@@ -22,78 +24,889 @@
 #define ERRFIFO_OVERWRITE_ON_FULL 1
 #endif
 
+/*默认淘汰策略，兼容ERRFIFO_OVERWRITE_ON_FULL，可用ErrCodeFIFO_SetEvictPolicy在运行时修改*/
+#ifndef ERRFIFO_EVICT_POLICY
+#if ERRFIFO_OVERWRITE_ON_FULL
+#define ERRFIFO_EVICT_POLICY ERRFIFO_EVICT_OLDEST
+#else
+#define ERRFIFO_EVICT_POLICY ERRFIFO_EVICT_REFUSE
+#endif
+#endif
+
 #ifndef ERRFIFO_USE_CRITICAL
 #define ERRFIFO_USE_CRITICAL 1
 #endif
 
+/*1:用散列索引查重，耗时与容量无关；0:不要索引，查重时线性扫描整个FIFO，每个元素省4~8字节RAM*/
+#ifndef ERRFIFO_DUP_INDEX
+#define ERRFIFO_DUP_INDEX 1
+#endif
+
+#if ERRFIFO_DUP_INDEX
+/*查重索引槽数，必须是2的幂且不小于2倍容量，保证开放寻址的探测长度与容量无关*/
+#ifndef ERRFIFO_INDEX_SIZE
+#if ERRFIFO_CAPACITY <= 16
+#define ERRFIFO_INDEX_SIZE 32
+#elif ERRFIFO_CAPACITY <= 32
+#define ERRFIFO_INDEX_SIZE 64
+#elif ERRFIFO_CAPACITY <= 64
+#define ERRFIFO_INDEX_SIZE 128
+#elif ERRFIFO_CAPACITY <= 128
+#define ERRFIFO_INDEX_SIZE 256
+#elif ERRFIFO_CAPACITY <= 256
+#define ERRFIFO_INDEX_SIZE 512
+#elif ERRFIFO_CAPACITY <= 512
+#define ERRFIFO_INDEX_SIZE 1024
+#elif ERRFIFO_CAPACITY <= 1024
+#define ERRFIFO_INDEX_SIZE 2048
+#else
+#define ERRFIFO_INDEX_SIZE 4096
+#endif
+#endif
+
+#if ((ERRFIFO_INDEX_SIZE & (ERRFIFO_INDEX_SIZE - 1)) != 0) || (ERRFIFO_INDEX_SIZE < 2 * ERRFIFO_CAPACITY) \
+    || (ERRFIFO_INDEX_SIZE > 65536)
+#error "ERRFIFO_INDEX_SIZE must be a power of two, >= 2 * ERRFIFO_CAPACITY and <= 65536"
+#endif
+#endif
+
+#if ERRFIFO_CAPACITY >= 0xFFFF
+#error "ERRFIFO_CAPACITY must be below 0xFFFF"
+#endif
+
 #if ERRFIFO_USE_CRITICAL
-#include "stm32f10x.h"  
+#include "critical.h"
+#endif
+
+#if ERRFIFO_CS_STATS && !ERRFIFO_USE_CRITICAL
+#include <time.h>
 #endif
 
+#if ERRFIFO_BENCH
+#if ERRFIFO_USE_CRITICAL || !ERRFIFO_CS_STATS
+#error "ERRFIFO_BENCH is a host build: needs ERRFIFO_USE_CRITICAL=0 and ERRFIFO_CS_STATS=1"
+#endif
+#include <stdio.h>
+#endif
+
+#if ERRFIFO_RETAIN
+#include "crc16.h"
+
+/*复位后不清零的段，ARMCC需在分散加载文件中把该段放入UNINIT执行域，GCC需在链接脚本中声明NOLOAD的.noinit段*/
+#ifndef ERRFIFO_NOINIT_ATTR
+#if defined(__CC_ARM)
+#define ERRFIFO_NOINIT_ATTR	__attribute__((section(".bss.noinit"), zero_init))
+#else
+#define ERRFIFO_NOINIT_ATTR	__attribute__((section(".noinit")))
+#endif
+#endif
+/*魔数中带上容量和元素大小，固件改变布局后不会接管旧内容*/
+#define ERRFIFO_MAGIC		(0x45460000U ^ ((u32)ERRFIFO_CAPACITY << 8) ^ ((u32)ERRFIFO_SEV_LEVELS << 5) \
+							 ^ (u32)sizeof(ErrCodeFifoSlot_t))
+#endif
+
+#if ERRFIFO_CS_STATS && ERRFIFO_USE_CRITICAL
+/*Cortex-M3 DWT周期计数器*/
+#define ERRFIFO_DEMCR		(*(volatile u32 *)0xE000EDFCU)
+#define ERRFIFO_DWT_CTRL	(*(volatile u32 *)0xE0001000U)
+#define ERRFIFO_DWT_CYCCNT	(*(volatile u32 *)0xE0001004U)
+#endif
+
+#if ERRFIFO_LAYOUT == ERRFIFO_LAYOUT_COMPACT
+/*8字节存储：时间戳只保存低32位，出队时以FIFO头部记录的最新时间为基准扩展为64位，
+  元素在队列中停留不超过2^32ms(约49.7天)即无损*/
 typedef struct
 {
-	ErrCodeFifoItem_t buf[ERRFIFO_CAPACITY];
-	u16 head;   
-	u16 tail;   
+	u32 ts_ms;    
+	u8  src;      
+	u8  flags;    
+	u16 fault;    
+} ErrCodeFifoSlot_t;
+
+/*COMPACT不存入队序号，跨等级按时间戳排序，同一毫秒内的先后用flags空闲的3位记录，出队时清零。
+  同一毫秒内超过8条时，第8条以后的跨等级先后不再区分，同一等级内的顺序不受影响*/
+#define ERRFIFO_FLAG_TIE_SHIFT	1
+#define ERRFIFO_FLAG_TIE_MASK	0x0E
+#define ERRFIFO_TIE_MAX			(ERRFIFO_FLAG_TIE_MASK >> ERRFIFO_FLAG_TIE_SHIFT)
+#define ERRFIFO_USE_SEQ			0
+#else
+typedef ErrCodeFifoItem_t ErrCodeFifoSlot_t;
+#define ERRFIFO_USE_SEQ			(ERRFIFO_SEV_LEVELS > 1)
+#endif
+
+#define ERRFIFO_NIL			0xFFFFU
+
+/*元素放在共用的槽池中，每个严重等级用next串成一条子队列，空闲槽串成空闲链表；
+  入队、出队、按等级淘汰都只操作链表头尾，耗时与容量无关*/
+typedef struct
+{
+	ErrCodeFifoSlot_t buf[ERRFIFO_CAPACITY];
+	u16 next[ERRFIFO_CAPACITY];  /*同一子队列中更新的元素，或空闲链表中的下一个空闲槽*/
+#if ERRFIFO_USE_SEQ
+	u32 seq[ERRFIFO_CAPACITY];   /*入队序号，跨等级出队时按序号恢复先后顺序*/
+#endif
+	u16 head[ERRFIFO_SEV_LEVELS];  /*各等级最旧的元素*/
+	u16 tail[ERRFIFO_SEV_LEVELS];  /*各等级最新的元素*/
+	u16 level_count[ERRFIFO_SEV_LEVELS];
+	u16 free;     /*空闲链表头*/
 	u16 count;  
+#if ERRFIFO_LAYOUT == ERRFIFO_LAYOUT_COMPACT
+	u8  tie;      /*最新元素的同毫秒序号*/
+#else
+	u32 next_seq; 
+#endif
+	u32 now_lo;   /*最近一次打时间戳时回调返回的值*/
+	u32 epoch_hi; /*回调返回值回绕的次数，即64位时间的高32位*/
+	u32 base;     /*加到回调返回值上的偏移，接管复位前的内容后让时间接着复位前的时间继续*/
+#if ERRFIFO_RETAIN
+	u32 magic;    
+	u16 hdr_crc;  /*next_seq(COMPACT为tie)/now_lo/epoch_hi/base的CRC，其余字段复位后由子队列重建，不参与校验*/
+	u16 chk[ERRFIFO_CAPACITY]; /*每个元素(含next/seq)的CRC，写入元素时更新，避免每次都校验整个队列*/
+#endif
 } ErrCodeFifo_t;
 
+#if ERRFIFO_DUP_INDEX
+#if ERRFIFO_COALESCE
+/*查重索引槽：合并模式下每个键只有一个元素，只记录它在buf中的位置，键从元素中读取*/
+typedef u16 ErrCodeFifoIdx_t;
+#define ERRFIFO_IDX_EMPTY	ERRFIFO_NIL
+#else
+/*查重索引槽：低24位为键(src<<16)|fault，高8位为该键在FIFO中的个数，0表示空槽。
+  同一个键超过255个时再占一个槽，探测链上同键的各槽个数相加即为总数*/
+typedef u32 ErrCodeFifoIdx_t;
+#define ERRFIFO_IDX_EMPTY	0U
+#define ERRFIFO_IDX_ONE		(1UL << 24)
+#define ERRFIFO_IDX_FULL	(0xFFUL << 24)
+#endif
+
+#define ERRFIFO_IDX_MASK	(ERRFIFO_INDEX_SIZE - 1U)
+#endif
+
+#if ERRFIFO_RETAIN
+ErrCodeFifo_t s_fifo ERRFIFO_NOINIT_ATTR;
+static u16 s_recovered = 0;
+#else
 ErrCodeFifo_t s_fifo;
+#endif
+#if ERRFIFO_DUP_INDEX
+static ErrCodeFifoIdx_t s_index[ERRFIFO_INDEX_SIZE];
+#endif
 static ErrCodeGetTimeMsFn s_get_time_ms = 0;
+static u8 s_policy = ERRFIFO_EVICT_POLICY;
+
+#if ERRFIFO_CS_STATS
+static ErrCodeFifoCsStats_t s_cs_stats;
+static u32 s_cs_start;
+
+/*
+***************************************************************************************
+* 函 数 名: _errfifo_cycles
+* 功能说明: 读取计时器，目标板上为DWT周期计数器，主机上为单调时钟(ns)
+* 形   参: 无
+* 返 回 值: 当前计数值
+***************************************************************************************
+*/
+static inline u32 _errfifo_cycles(void)
+{
+#if ERRFIFO_USE_CRITICAL
+	return ERRFIFO_DWT_CYCCNT;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u32)((unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec);
+#endif
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _errfifo_cs_begin / _errfifo_cs_end
+* 功能说明: 记录一次临界区的起止时间，累计次数、总时长和最长时长
+* 形   参: 无
+* 返 回 值: 无
+***************************************************************************************
+*/
+static inline void _errfifo_cs_begin(void)
+{
+	s_cs_start = _errfifo_cycles();
+}
+
+static inline void _errfifo_cs_end(void)
+{
+	u32 len = _errfifo_cycles() - s_cs_start;
+	s_cs_stats.count++;
+	s_cs_stats.total += len;
+	if (len > s_cs_stats.max)
+	{
+		s_cs_stats.max = len;
+	}
+}
+#else
+static inline void _errfifo_cs_begin(void) {}
+static inline void _errfifo_cs_end(void) {}
+#endif
 
 #if ERRFIFO_USE_CRITICAL
 /*
 ***************************************************************************************
 * 函 数 名: _errfifo_enter
-* 功能说明: 进入临界区，短暂屏蔽中断，返回进入前的 PRIMASK 状态
+* 功能说明: 进入临界区(见critical.h)，并开始统计临界区时长
 * 形   参: 无
 * 返 回 值: 进入前的 PRIMASK 值（0 表示原本开中断，1 表示原本关中断）
 ***************************************************************************************
 */
 static inline u32 _errfifo_enter(void)
 {
-	u32 pm = __get_PRIMASK();
-	__disable_irq();
+	u32 pm = Critical_Enter();
+	_errfifo_cs_begin();
 	return pm;
 }
 
 /*
 ***************************************************************************************
-* 函 数 名: _errfifo_exit
-* 功能说明: 退出临界区，根据进入前的 PRIMASK 状态决定是否恢复中断
-* 形   参: pm - 进入临界区前保存的 PRIMASK 值
-* 返 回 值: 无
+* 函 数 名: _errfifo_exit
+* 功能说明: 结束临界区时长统计，退出临界区
+* 形   参: pm - 进入临界区前保存的 PRIMASK 值
+* 返 回 值: 无
+***************************************************************************************
+*/
+static inline void _errfifo_exit(u32 pm)
+{
+	_errfifo_cs_end();
+	Critical_Exit(pm);
+}
+#else
+static inline u32 _errfifo_enter(void) { _errfifo_cs_begin(); return 0U; }
+static inline void _errfifo_exit(u32 pm) { (void)pm; _errfifo_cs_end(); }
+#endif
+
+/*
+***************************************************************************************
+* 函 数 名: _key
+* 功能说明: 由错误来源和故障码组成查重索引的键
+* 形   参: src - 错误来源；fault - 故障码(16位)
+* 返 回 值: 索引键
+***************************************************************************************
+*/
+static inline u32 _key(u8 src, u16 fault)
+{
+	return ((u32)src << 16) | fault;
+}
+
+#if ERRFIFO_DUP_INDEX
+/*
+***************************************************************************************
+* 函 数 名: _idx_home
+* 功能说明: 计算键在查重索引中的起始槽位(乘法散列)
+* 形   参: key - 索引键
+* 返 回 值: 槽位
+***************************************************************************************
+*/
+static inline u16 _idx_home(u32 key)
+{
+	return (u16)(((key * 2654435761U) >> 16) & ERRFIFO_IDX_MASK);
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _idx_key
+* 功能说明: 取非空索引槽对应的键
+* 形   参: i - 槽位
+* 返 回 值: 索引键
+***************************************************************************************
+*/
+static inline u32 _idx_key(u16 i)
+{
+#if ERRFIFO_COALESCE
+	const ErrCodeFifoSlot_t *it = &s_fifo.buf[s_index[i]];
+	return _key(it->src, it->fault);
+#else
+	return s_index[i] & 0x00FFFFFFU;
+#endif
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _idx_find
+* 功能说明: 线性探测查找键所在的槽位，装载率不超过1/2，探测长度与FIFO容量无关
+* 形   参: key - 索引键
+* 返 回 值: 槽位，-1 表示不存在
+***************************************************************************************
+*/
+static int _idx_find(u32 key)
+{
+	u16 i = _idx_home(key);
+	while (s_index[i] != ERRFIFO_IDX_EMPTY)
+	{
+		if (_idx_key(i) == key)
+		{
+			return i;
+		}
+		i = (u16)((i + 1U) & ERRFIFO_IDX_MASK);
+	}
+	return -1;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _idx_add
+* 功能说明: 元素入队时增加键的计数，不存在则插入
+* 形   参: key - 索引键；pos - 元素在buf中的位置
+* 返 回 值: 键所在的槽位
+***************************************************************************************
+*/
+static u16 _idx_add(u32 key, u16 pos)
+{
+	u16 i = _idx_home(key);
+	while (s_index[i] != ERRFIFO_IDX_EMPTY)
+	{
+#if ERRFIFO_COALESCE
+		if (_idx_key(i) == key)
+		{
+			return i;
+		}
+#else
+		if (((s_index[i] & 0x00FFFFFFU) == key) && ((s_index[i] & ERRFIFO_IDX_FULL) != ERRFIFO_IDX_FULL))
+		{
+			s_index[i] += ERRFIFO_IDX_ONE;
+			return i;
+		}
+#endif
+		i = (u16)((i + 1U) & ERRFIFO_IDX_MASK);
+	}
+#if ERRFIFO_COALESCE
+	s_index[i] = pos;
+#else
+	(void)pos;
+	s_index[i] = key | ERRFIFO_IDX_ONE;
+#endif
+	return i;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _idx_del
+* 功能说明: 元素出队或被覆盖时减少键的计数，减到0时删除并把后续探测链前移填补空槽，
+*          不使用删除标记，索引不会随时间退化
+* 形   参: key - 索引键；pos - 元素在buf中的位置，调用时元素内容仍有效
+* 返 回 值: 无
+***************************************************************************************
+*/
+static void _idx_del(u32 key, u16 pos)
+{
+	int slot = _idx_find(key);
+	if (slot < 0)
+	{
+		return;
+	}
+#if ERRFIFO_COALESCE
+	if (s_index[slot] != pos)
+	{
+		return;
+	}
+#else
+	(void)pos;
+	s_index[slot] -= ERRFIFO_IDX_ONE;
+	if ((s_index[slot] & ERRFIFO_IDX_FULL) != 0U)
+	{
+		return;
+	}
+#endif
+
+	u16 hole = (u16)slot;
+	u16 j = hole;
+	for (;;)
+	{
+		j = (u16)((j + 1U) & ERRFIFO_IDX_MASK);
+		if (s_index[j] == ERRFIFO_IDX_EMPTY)
+		{
+			break;
+		}
+		/*j处元素的起始槽不在(hole, j]内时，把它前移到空槽*/
+		u16 home = _idx_home(_idx_key(j));
+		if (((j - home) & ERRFIFO_IDX_MASK) >= ((j - hole) & ERRFIFO_IDX_MASK))
+		{
+			s_index[hole] = s_index[j];
+			hole = j;
+		}
+	}
+	s_index[hole] = ERRFIFO_IDX_EMPTY;
+}
+#else
+static inline void _idx_add(u32 key, u16 pos) { (void)key; (void)pos; }
+static inline void _idx_del(u32 key, u16 pos) { (void)key; (void)pos; }
+#endif
+
+/*
+***************************************************************************************
+* 函 数 名: _find
+* 功能说明: 查找(src,fault)是否在FIFO中，有查重索引时查索引，否则逐个等级扫描子队列，调用前需已进入临界区
+* 形   参: src - 错误来源；fault - 故障码(16位)
+* 返 回 值: -1 表示不存在；否则表示存在，合并模式下为元素在buf中的位置
+***************************************************************************************
+*/
+static int _find(u8 src, u16 fault)
+{
+#if ERRFIFO_DUP_INDEX
+	int slot = _idx_find(_key(src, fault));
+#if ERRFIFO_COALESCE
+	return (slot < 0) ? -1 : (int)s_index[slot];
+#else
+	return slot;
+#endif
+#else
+	for (u8 lv = 0U; lv < ERRFIFO_SEV_LEVELS; lv++)
+	{
+		for (u16 idx = s_fifo.head[lv]; idx != ERRFIFO_NIL; idx = s_fifo.next[idx])
+		{
+			if ((s_fifo.buf[idx].src == src) && (s_fifo.buf[idx].fault == fault))
+			{
+				return idx;
+			}
+		}
+	}
+	return -1;
+#endif
+}
+
+#if ERRFIFO_RETAIN
+/*
+***************************************************************************************
+* 函 数 名: _hdr_crc
+* 功能说明: 计算FIFO头部中无法由子队列重建的字段(入队序号和时间)的CRC，逐个字段计算，
+*          不包含结构体填充字节。只有入队和合并会修改这些字段，在公开操作结束前更新一次
+* 形   参: 无
+* 返 回 值: CRC值
+***************************************************************************************
+*/
+static u16 _hdr_crc(void)
+{
+	u16 crc = 0xFFFFU;
+#if ERRFIFO_LAYOUT == ERRFIFO_LAYOUT_COMPACT
+	crc = Crc16_Calc(crc, &s_fifo.tie, sizeof(s_fifo.tie));
+#else
+	crc = Crc16_Calc(crc, &s_fifo.next_seq, sizeof(s_fifo.next_seq));
+#endif
+	crc = Crc16_Calc(crc, &s_fifo.now_lo, sizeof(s_fifo.now_lo));
+	crc = Crc16_Calc(crc, &s_fifo.epoch_hi, sizeof(s_fifo.epoch_hi));
+	crc = Crc16_Calc(crc, &s_fifo.base, sizeof(s_fifo.base));
+	return crc;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _slot_crc
+* 功能说明: 计算一个元素的CRC，包括元素内容、链表指针和入队序号
+* 形   参: pos - 槽位
+* 返 回 值: CRC值
+***************************************************************************************
+*/
+static u16 _slot_crc(u16 pos)
+{
+	u16 crc = Crc16_Calc(0xFFFFU, &s_fifo.buf[pos], sizeof(ErrCodeFifoSlot_t));
+	crc = Crc16_Calc(crc, &s_fifo.next[pos], sizeof(s_fifo.next[pos]));
+#if ERRFIFO_USE_SEQ
+	crc = Crc16_Calc(crc, &s_fifo.seq[pos], sizeof(s_fifo.seq[pos]));
+#endif
+	return crc;
+}
+
+static inline void _seal_hdr(void) { s_fifo.hdr_crc = _hdr_crc(); }
+static inline void _seal_slot(u16 pos) { s_fifo.chk[pos] = _slot_crc(pos); }
+#else
+static inline void _seal_hdr(void) {}
+static inline void _seal_slot(u16 pos) { (void)pos; }
+#endif
+
+#if ERRFIFO_SEV_LEVELS > 1
+/*
+***************************************************************************************
+* 函 数 名: _older
+* 功能说明: 判断两个元素的入队先后，COMPACT比较32位时间戳和同毫秒序号，其余布局比较入队序号
+* 形   参: a - 槽位；b - 槽位
+* 返 回 值: 1 表示a比b先入队；0 表示不是
+***************************************************************************************
+*/
+static inline int _older(u16 a, u16 b)
+{
+#if ERRFIFO_LAYOUT == ERRFIFO_LAYOUT_COMPACT
+	s32 d = (s32)(s_fifo.buf[a].ts_ms - s_fifo.buf[b].ts_ms);
+	if (d != 0)
+	{
+		return (d < 0) ? 1 : 0;
+	}
+	return ((s_fifo.buf[a].flags & ERRFIFO_FLAG_TIE_MASK) < (s_fifo.buf[b].flags & ERRFIFO_FLAG_TIE_MASK)) ? 1 : 0;
+#else
+	return ((s32)(s_fifo.seq[a] - s_fifo.seq[b]) < 0) ? 1 : 0;
+#endif
+}
+#endif
+
+/*
+***************************************************************************************
+* 函 数 名: _oldest_level
+* 功能说明: 比较各等级子队列头部的入队先后，找出全局最旧元素所在的等级，调用前需队列非空
+* 形   参: 无
+* 返 回 值: 等级
+***************************************************************************************
+*/
+static inline u8 _oldest_level(void)
+{
+#if ERRFIFO_SEV_LEVELS > 1
+	u8 best = 0xFFU;
+	for (u8 lv = 0U; lv < ERRFIFO_SEV_LEVELS; lv++)
+	{
+		if (s_fifo.head[lv] == ERRFIFO_NIL)
+		{
+			continue;
+		}
+		if ((best == 0xFFU) || _older(s_fifo.head[lv], s_fifo.head[best]))
+		{
+			best = lv;
+		}
+	}
+	return best;
+#else
+	return 0U;
+#endif
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _drop_head
+* 功能说明: 丢弃某一等级最旧的元素，槽位归还空闲链表并同步查重索引，调用前需已进入临界区且该等级非空
+* 形   参: lv - 等级
+* 返 回 值: 无
+***************************************************************************************
+*/
+static inline void _drop_head(u8 lv)
+{
+	u16 pos = s_fifo.head[lv];
+	const ErrCodeFifoSlot_t *it = &s_fifo.buf[pos];
+	_idx_del(_key(it->src, it->fault), pos);
+	s_fifo.head[lv] = s_fifo.next[pos];
+	if (s_fifo.head[lv] == ERRFIFO_NIL)
+	{
+		s_fifo.tail[lv] = ERRFIFO_NIL;
+	}
+	s_fifo.next[pos] = s_fifo.free;
+	s_fifo.free = pos;
+	s_fifo.level_count[lv]--;
+	s_fifo.count--;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _now
+* 功能说明: 通过回调获取当前时间
+* 形   参: 无
+* 返 回 值: 当前时间(ms)，未设置回调时为0
+***************************************************************************************
+*/
+static inline u32 _now(void)
+{
+	return (s_get_time_ms ? s_get_time_ms() : 0);
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _stamp
+* 功能说明: 获取当前时间并扩展为64位，回调返回值变小时认为发生了回绕，调用前需已进入临界区
+* 形   参: 无
+* 返 回 值: 64位时间(ms)
+***************************************************************************************
+*/
+static inline unsigned long long _stamp(void)
+{
+	u32 now = _now() + s_fifo.base;
+	if (now < s_fifo.now_lo)
+	{
+		s_fifo.epoch_hi++;
+	}
+	s_fifo.now_lo = now;
+	return ((unsigned long long)s_fifo.epoch_hi << 32) | now;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _load
+* 功能说明: 把FIFO中的元素还原为出队结构，COMPACT布局下把32位时间戳扩展为64位
+* 形   参: out - 输出元素；slot - FIFO中的元素
+* 返 回 值: 无
+***************************************************************************************
+*/
+static inline void _load(ErrCodeFifoItem_t *out, const ErrCodeFifoSlot_t *slot)
+{
+#if ERRFIFO_LAYOUT == ERRFIFO_LAYOUT_COMPACT
+	unsigned long long latest = ((unsigned long long)s_fifo.epoch_hi << 32) | s_fifo.now_lo;
+	out->ts_ms = latest - (u32)(s_fifo.now_lo - slot->ts_ms);
+	out->src   = slot->src;
+	out->flags = (u8)(slot->flags & ~ERRFIFO_FLAG_TIE_MASK);
+	out->fault = slot->fault;
+#else
+	*out = *slot;
+#endif
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _evict
+* 功能说明: 队列满时按淘汰策略腾出一个槽位，被淘汰等级的新的最旧元素打上ERRFIFO_FLAG_GAP
+* 形   参: sev - 新元素的等级
+* 返 回 值: 1 表示已腾出；0 表示策略拒绝新元素
+***************************************************************************************
+*/
+static int _evict(u8 sev)
+{
+	u8 lv = 0U;
+	switch (s_policy)
+	{
+	case ERRFIFO_EVICT_OLDEST:
+		lv = _oldest_level();
+		break;
+	case ERRFIFO_EVICT_LOWEST:
+		while (s_fifo.head[lv] == ERRFIFO_NIL)
+		{
+			lv++;
+		}
+		if (lv > sev)
+		{
+			return 0;
+		}
+		break;
+	default:
+		return 0;
+	}
+
+	_drop_head(lv);
+	if (s_fifo.head[lv] != ERRFIFO_NIL)
+	{
+		s_fifo.buf[s_fifo.head[lv]].flags |= ERRFIFO_FLAG_GAP;
+		_seal_slot(s_fifo.head[lv]);
+	}
+	return 1;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _append
+* 功能说明: 从空闲链表取一个槽位写入新元素，挂到该等级子队列末尾并加入查重索引，
+*          调用前需已进入临界区且队列未满
+* 形   参: src - 错误来源；fault - 故障码(16位)；sev - 严重等级
+* 返 回 值: 无
+***************************************************************************************
+*/
+static inline void _append(u8 src, u16 fault, u8 sev)
+{
+	u16 pos = s_fifo.free;
+	s_fifo.free = s_fifo.next[pos];
+
+	ErrCodeFifoSlot_t *item = &s_fifo.buf[pos];
+#if ERRFIFO_LAYOUT == ERRFIFO_LAYOUT_COMPACT
+	u32 prev = s_fifo.now_lo;
+	unsigned long long ts = _stamp();
+	if ((u32)ts != prev)
+	{
+		s_fifo.tie = 0U;
+	}
+	else if (s_fifo.tie < ERRFIFO_TIE_MAX)
+	{
+		s_fifo.tie++;
+	}
+	item->flags = (u8)((sev << ERRFIFO_FLAG_SEV_SHIFT) | (s_fifo.tie << ERRFIFO_FLAG_TIE_SHIFT));
+#else
+	unsigned long long ts = _stamp();
+	item->flags = (u8)(sev << ERRFIFO_FLAG_SEV_SHIFT);
+#endif
+	item->src   = src;
+	item->ts_ms = ts;
+	item->fault = fault;
+	_idx_add(_key(src, fault), pos);
+#if ERRFIFO_COALESCE
+	item->count = 1U;
+	item->last_ts_ms = (u32)ts;
+#endif
+	s_fifo.next[pos] = ERRFIFO_NIL;
+#if ERRFIFO_USE_SEQ
+	s_fifo.seq[pos] = s_fifo.next_seq;
+#endif
+#if ERRFIFO_LAYOUT != ERRFIFO_LAYOUT_COMPACT
+	s_fifo.next_seq++;
+#endif
+	_seal_slot(pos);
+
+	if (s_fifo.tail[sev] == ERRFIFO_NIL)
+	{
+		s_fifo.head[sev] = pos;
+	}
+	else
+	{
+		s_fifo.next[s_fifo.tail[sev]] = pos;
+		_seal_slot(s_fifo.tail[sev]);
+	}
+	s_fifo.tail[sev] = pos;
+	s_fifo.level_count[sev]++;
+	s_fifo.count++;
+}
+
+#if ERRFIFO_COALESCE
+/*
+***************************************************************************************
+* 函 数 名: _coalesce
+* 功能说明: (src,fault)已在FIFO中时累加其次数并更新最后出现时间，等级保持首次出现时的等级，
+*          调用前需已进入临界区
+* 形   参: src - 错误来源；fault - 故障码(16位)
+* 返 回 值: 1 表示已合并；0 表示不存在
 ***************************************************************************************
 */
-static inline void _errfifo_exit(u32 pm)
+static int _coalesce(u8 src, u16 fault)
 {
-	if ((pm & 1U) == 0U)
+	int pos = _find(src, fault);
+	if (pos < 0)
+	{
+		return 0;
+	}
+	ErrCodeFifoSlot_t *item = &s_fifo.buf[pos];
+	if (item->count != 0xFFFFU)
 	{
-		__enable_irq();
+		item->count++;
 	}
+	item->last_ts_ms = (u32)_stamp();
+	_seal_slot((u16)pos);
+	return 1;
 }
-#else
-static inline u32 _errfifo_enter(void) { return 0U; }
-static inline void _errfifo_exit(u32 pm) { (void)pm; }
 #endif
 
+#if ERRFIFO_RETAIN
 /*
 ***************************************************************************************
-* 函 数 名: _inc
-* 功能说明: 环形缓冲索引自增，超出容量后从 0 重新开始
-* 形   参: x - 当前索引
-* 返 回 值: 自增后的索引值
+* 函 数 名: _adopt
+* 功能说明: 校验复位后保留RAM中的FIFO：魔数不对则整体丢弃；沿各等级子队列逐个校验元素，
+*          遇到损坏、越界或重复出现的元素时该等级从此截断，截断前的元素保留并重建查重索引，
+*          队尾、计数和空闲链表都由子队列重建，队头只作为遍历起点。头部CRC不对(如在入队中途复位)
+*          时不丢弃，入队序号和时间改由接管的元素推出。
+*          复位后时间回调从0重新计数，有元素被接管时把复位前最后的时间作为偏移加到回调值上，
+*          时间轴接着复位前继续，新旧元素保持先后顺序，COMPACT布局的扩展也不受影响
+* 形   参: 无
+* 返 回 值: 1 表示已接管(可能为0条)；0 表示内容无效，需要清空
 ***************************************************************************************
 */
-static inline u16 _inc(u16 x)
+static int _adopt(void)
 {
-	return (u16)((x + 1U) % ERRFIFO_CAPACITY);
+	u32 used[(ERRFIFO_CAPACITY + 31) / 32];
+	u16 i = 0U;
+	u16 newest = ERRFIFO_NIL;
+
+	s_recovered = 0U;
+	if (s_fifo.magic != ERRFIFO_MAGIC)
+	{
+		return 0;
+	}
+	u8 hdr_ok = (s_fifo.hdr_crc == _hdr_crc()) ? 1U : 0U;
+
+	for (i = 0U; i < (ERRFIFO_CAPACITY + 31) / 32; i++)
+	{
+		used[i] = 0U;
+	}
+	s_fifo.count = 0U;
+	for (u8 lv = 0U; lv < ERRFIFO_SEV_LEVELS; lv++)
+	{
+		u16 prev = ERRFIFO_NIL;
+		u16 pos = s_fifo.head[lv];
+		u16 n = 0U;
+		while ((pos < ERRFIFO_CAPACITY) && ((used[pos / 32U] & (1UL << (pos % 32U))) == 0U)
+		       && (s_fifo.chk[pos] == _slot_crc(pos)) && (ERRFIFO_ITEM_SEV(&s_fifo.buf[pos]) == lv))
+		{
+			used[pos / 32U] |= 1UL << (pos % 32U);
+			_idx_add(_key(s_fifo.buf[pos].src, s_fifo.buf[pos].fault), pos);
+			n++;
+			prev = pos;
+			pos = s_fifo.next[pos];
+		}
+
+		/*中途截断的子队列，最后一个有效元素成为新的队尾*/
+		if (pos != ERRFIFO_NIL)
+		{
+			if (prev == ERRFIFO_NIL)
+			{
+				s_fifo.head[lv] = ERRFIFO_NIL;
+			}
+			else
+			{
+				s_fifo.next[prev] = ERRFIFO_NIL;
+				_seal_slot(prev);
+			}
+		}
+		s_fifo.tail[lv] = prev;
+		s_fifo.level_count[lv] = n;
+		s_fifo.count += n;
+
+		/*各等级队尾中最后入队的是最新的元素*/
+		if ((prev != ERRFIFO_NIL) && ((newest == ERRFIFO_NIL)
+#if ERRFIFO_SEV_LEVELS > 1
+		    || _older(newest, prev)
+#endif
+		    ))
+		{
+			newest = prev;
+		}
+	}
+
+	if ((hdr_ok == 0U) && (newest != ERRFIFO_NIL))
+	{
+#if ERRFIFO_USE_SEQ
+		s_fifo.next_seq = s_fifo.seq[newest] + 1U;
+#endif
+		s_fifo.now_lo = (u32)s_fifo.buf[newest].ts_ms;
+#if ERRFIFO_LAYOUT == ERRFIFO_LAYOUT_COMPACT
+		s_fifo.tie = (u8)((s_fifo.buf[newest].flags & ERRFIFO_FLAG_TIE_MASK) >> ERRFIFO_FLAG_TIE_SHIFT);
+		s_fifo.epoch_hi = 0U;
+#else
+		s_fifo.epoch_hi = (u32)(s_fifo.buf[newest].ts_ms >> 32);
+#endif
+#if ERRFIFO_COALESCE
+		/*合并过的元素最后出现时间可能比最新元素的入队时间更晚*/
+		for (i = 0U; i < ERRFIFO_CAPACITY; i++)
+		{
+			if (((used[i / 32U] & (1UL << (i % 32U))) != 0U)
+			    && ((s32)(s_fifo.buf[i].last_ts_ms - s_fifo.now_lo) > 0))
+			{
+				s_fifo.now_lo = s_fifo.buf[i].last_ts_ms;
+			}
+		}
+#endif
+	}
+
+	s_fifo.free = ERRFIFO_NIL;
+	for (i = ERRFIFO_CAPACITY; i-- > 0U; )
+	{
+		if ((used[i / 32U] & (1UL << (i % 32U))) == 0U)
+		{
+			s_fifo.next[i] = s_fifo.free;
+			s_fifo.free = i;
+		}
+	}
+
+	if (s_fifo.count > 0U)
+	{
+		s_fifo.base = s_fifo.now_lo;
+	}
+	else
+	{
+		s_fifo.now_lo = 0U;
+		s_fifo.epoch_hi = 0U;
+		s_fifo.base = 0U;
+	}
+	_seal_hdr();
+	s_recovered = s_fifo.count;
+	return 1;
 }
+#endif
 
 /*
 ***************************************************************************************
 * 函 数 名: ErrCodeFIFO_Init
-* 功能说明: 初始化错误码 FIFO，清空队列并设置时间获取函数
+* 功能说明: 初始化错误码 FIFO，清空队列并设置时间获取函数。开启ERRFIFO_RETAIN时
+*          保留RAM中的内容校验通过则接管，不清空
 * 形   参: get_time_ms - 获取当前时间(毫秒)的回调函数指针，可为 NULL
 * 返 回 值: 无
 ***************************************************************************************
@@ -101,11 +914,49 @@ static inline u16 _inc(u16 x)
 void ErrCodeFIFO_Init(ErrCodeGetTimeMsFn get_time_ms)
 {
 	u32 pm = _errfifo_enter();
-	s_fifo.head = 0;
-	s_fifo.tail = 0;
-	s_fifo.count = 0;
+#if ERRFIFO_DUP_INDEX
+	for (u32 i = 0U; i < ERRFIFO_INDEX_SIZE; i++)
+	{
+		s_index[i] = ERRFIFO_IDX_EMPTY;
+	}
+#endif
+#if ERRFIFO_RETAIN
+	if (_adopt() == 0)
+#endif
+	{
+		for (u16 i = 0U; i < ERRFIFO_CAPACITY; i++)
+		{
+			s_fifo.next[i] = (u16)(i + 1U);
+		}
+		s_fifo.next[ERRFIFO_CAPACITY - 1] = ERRFIFO_NIL;
+		s_fifo.free = 0;
+		for (u8 lv = 0U; lv < ERRFIFO_SEV_LEVELS; lv++)
+		{
+			s_fifo.head[lv] = ERRFIFO_NIL;
+			s_fifo.tail[lv] = ERRFIFO_NIL;
+			s_fifo.level_count[lv] = 0;
+		}
+		s_fifo.count = 0;
+#if ERRFIFO_LAYOUT == ERRFIFO_LAYOUT_COMPACT
+		s_fifo.tie = 0;
+#else
+		s_fifo.next_seq = 0;
+#endif
+		s_fifo.now_lo = 0;
+		s_fifo.epoch_hi = 0;
+		s_fifo.base = 0;
+#if ERRFIFO_RETAIN
+		s_fifo.magic = ERRFIFO_MAGIC;
+		_seal_hdr();
+#endif
+	}
 	s_get_time_ms = get_time_ms;
 	_errfifo_exit(pm);
+
+#if ERRFIFO_CS_STATS && ERRFIFO_USE_CRITICAL
+	ERRFIFO_DEMCR |= (1UL << 24);       /*TRCENA*/
+	ERRFIFO_DWT_CTRL |= 1UL;            /*CYCCNTENA*/
+#endif
 }
 
 /*
@@ -147,10 +998,40 @@ u16 ErrCodeFIFO_Size(void)
 	return s_fifo.count;
 }
 
+/*
+***************************************************************************************
+* 函 数 名: ErrCodeFIFO_SizeSev
+* 功能说明: 获取 FIFO 中某一严重等级的元素个数
+* 形   参: sev - 严重等级
+* 返 回 值: 该等级的元素个数，等级无效时为0
+***************************************************************************************
+*/
+u16 ErrCodeFIFO_SizeSev(u8 sev)
+{
+	return (sev < ERRFIFO_SEV_LEVELS) ? s_fifo.level_count[sev] : 0U;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: ErrCodeFIFO_SetEvictPolicy
+* 功能说明: 设置队列满时的淘汰策略，无效值忽略
+* 形   参: policy - ERRFIFO_EVICT_OLDEST/LOWEST/REFUSE
+* 返 回 值: 无
+***************************************************************************************
+*/
+void ErrCodeFIFO_SetEvictPolicy(u8 policy)
+{
+	if (policy <= ERRFIFO_EVICT_REFUSE)
+	{
+		s_policy = policy;
+	}
+}
+
 /*
 ***************************************************************************************
 * 函 数 名: ErrCodeFIFO_Contains
-* 功能说明: 判断 (src,fault) 是否已存在于 FIFO 中
+* 功能说明: 判断 (src,fault) 是否已存在于 FIFO 中，通过查重索引查找，耗时与容量无关；
+*          ERRFIFO_DUP_INDEX=0时线性扫描
 * 形   参: src - 错误来源；fault - 故障码(16位)
 * 返 回 值: 1 表示存在；0 表示不存在
 ***************************************************************************************
@@ -158,63 +1039,65 @@ u16 ErrCodeFIFO_Size(void)
 int ErrCodeFIFO_Contains(ErrCodeSrc src, u16 fault)
 {
 	u32 pm = _errfifo_enter();
-
-	u16 i = 0U;
-	u16 idx = s_fifo.tail;
-	for (i = 0U; i < s_fifo.count; i++)
-	{
-		const ErrCodeFifoItem_t *it = &s_fifo.buf[idx];
-		if ((it->src == (u8)src) && (it->fault == fault))
-		{
-			_errfifo_exit(pm);
-			return 1;
-		}
-		idx = _inc(idx);
-	}
-
+	int found = (_find((u8)src, fault) >= 0) ? 1 : 0;
 	_errfifo_exit(pm);
-	return 0;
+	return found;
 }
 
 /*
 ***************************************************************************************
-* 函 数 名: ErrCodeFIFO_Push
-* 功能说明: 向 FIFO 末尾写入一条错误信息（满时可选择覆盖最旧元素）
-* 形   参: src - 错误来源；fault - 故障码(16位)
-* 返 回 值: 0 表示成功；-1 表示队列已满且未配置覆盖
+* 函 数 名: ErrCodeFIFO_PushSev
+* 功能说明: 向 FIFO 写入一条指定严重等级的错误信息，满时按淘汰策略腾出位置，
+*          合并模式下已存在的 (src,fault) 只累加次数和更新最后出现时间
+* 形   参: src - 错误来源；fault - 故障码(16位)；sev - 严重等级，超出范围时按最高等级
+* 返 回 值: 0 表示成功；-1 表示队列已满且被淘汰策略拒绝
 ***************************************************************************************
 */
-int ErrCodeFIFO_Push(ErrCodeSrc src, u16 fault)
+int ErrCodeFIFO_PushSev(ErrCodeSrc src, u16 fault, u8 sev)
 {
+	if (sev >= ERRFIFO_SEV_LEVELS) {sev = ERRFIFO_SEV_LEVELS - 1;}
+
 	u32 pm = _errfifo_enter();
 
-	if (s_fifo.count == ERRFIFO_CAPACITY)
+#if ERRFIFO_COALESCE
+	if (_coalesce((u8)src, fault))
 	{
-#if ERRFIFO_OVERWRITE_ON_FULL
-		s_fifo.tail = _inc(s_fifo.tail);
-		s_fifo.count--;
-#else
+		_seal_hdr();
 		_errfifo_exit(pm);
-		return -1;
-#endif
+		return 0;
 	}
+#endif
 
-	ErrCodeFifoItem_t *item = &s_fifo.buf[s_fifo.head];
-	item->src   = (u8)src;
-	item->ts_ms = (s_get_time_ms ? s_get_time_ms() : 0);
-	item->fault = fault;
+	if ((s_fifo.count == ERRFIFO_CAPACITY) && (_evict(sev) == 0))
+	{
+		_errfifo_exit(pm);
+		return -1;
+	}
 
-	s_fifo.head = _inc(s_fifo.head);
-	s_fifo.count++;
+	_append((u8)src, fault, sev);
+	_seal_hdr();
 
 	_errfifo_exit(pm);
 	return 0;
 }
 
+/*
+***************************************************************************************
+* 函 数 名: ErrCodeFIFO_Push
+* 功能说明: 以ERRFIFO_SEV_DEFAULT等级写入一条错误信息，见ErrCodeFIFO_PushSev
+* 形   参: src - 错误来源；fault - 故障码(16位)
+* 返 回 值: 0 表示成功；-1 表示队列已满且被淘汰策略拒绝
+***************************************************************************************
+*/
+int ErrCodeFIFO_Push(ErrCodeSrc src, u16 fault)
+{
+	return ErrCodeFIFO_PushSev(src, fault, ERRFIFO_SEV_DEFAULT);
+}
+
 /*
 ***************************************************************************************
 * 函 数 名: ErrCodeFIFO_Pop
-* 功能说明: 从 FIFO 头部弹出一条错误信息
+* 功能说明: 弹出所有等级中最旧的一条错误信息
 * 形   参: out - 输出参数，接收弹出的元素，不能为空
 * 返 回 值: 1 表示成功弹出；0 表示队列为空
 ***************************************************************************************
@@ -231,18 +1114,45 @@ int ErrCodeFIFO_Pop(ErrCodeFifoItem_t *out)
 		return 0;
 	}
 
-	*out = s_fifo.buf[s_fifo.tail];
-	s_fifo.tail = _inc(s_fifo.tail);
-	s_fifo.count--;
+	u8 lv = _oldest_level();
+	_load(out, &s_fifo.buf[s_fifo.head[lv]]);
+	_drop_head(lv);
 
 	_errfifo_exit(pm);
 	return 1;
 }
 
+/*
+***************************************************************************************
+* 函 数 名: ErrCodeFIFO_PopBatch
+* 功能说明: 在一次临界区内按入队顺序弹出最多 max 条错误信息，保证同一批内的顺序连续
+* 形   参: out - 输出数组，至少能容纳 max 个元素；max - 最多弹出的条数
+* 返 回 值: 实际弹出的条数，0 表示队列为空
+***************************************************************************************
+*/
+u16 ErrCodeFIFO_PopBatch(ErrCodeFifoItem_t *out, u16 max)
+{
+	if ((out == 0) || (max == 0U)) {return 0;}
+
+	u32 pm = _errfifo_enter();
+
+	u16 n = (s_fifo.count < max) ? s_fifo.count : max;
+	u16 i = 0U;
+	for (i = 0U; i < n; i++)
+	{
+		u8 lv = _oldest_level();
+		_load(&out[i], &s_fifo.buf[s_fifo.head[lv]]);
+		_drop_head(lv);
+	}
+
+	_errfifo_exit(pm);
+	return n;
+}
+
 /*
 ***************************************************************************************
 * 函 数 名: ErrCodeFIFO_Peek
-* 功能说明: 查看 FIFO 头部元素但不弹出
+* 功能说明: 查看所有等级中最旧的元素但不弹出
 * 形   参: out - 输出参数，接收查看到的元素，不能为空
 * 返 回 值: 1 表示存在元素；0 表示队列为空
 ***************************************************************************************
@@ -260,7 +1170,7 @@ int ErrCodeFIFO_Peek(ErrCodeFifoItem_t *out)
 		return 0;
 	}
 
-	*out = s_fifo.buf[s_fifo.tail];
+	_load(out, &s_fifo.buf[s_fifo.head[_oldest_level()]]);
 
 	_errfifo_exit(pm);
 	return 1;
@@ -268,51 +1178,220 @@ int ErrCodeFIFO_Peek(ErrCodeFifoItem_t *out)
 
 /*
 ***************************************************************************************
-* 函 数 名: ErrCodeFIFO_PushIfAbsent
-* 功能说明: 若 (src,fault) 不存在则入队；已存在则不入队
-* 形   参: src - 错误来源；fault - 故障码(16位)
-* 返 回 值: 1 表示成功入队；0 表示已存在未入队；-1 表示队列满且未覆盖
+* 函 数 名: ErrCodeFIFO_PushIfAbsentSev
+* 功能说明: 若 (src,fault) 不存在则以指定严重等级入队；已存在则不入队，合并模式下累加其次数
+* 形   参: src - 错误来源；fault - 故障码(16位)；sev - 严重等级，超出范围时按最高等级
+* 返 回 值: 1 表示成功入队；0 表示已存在未入队；-1 表示队列满且被淘汰策略拒绝
 ***************************************************************************************
 */
-int ErrCodeFIFO_PushIfAbsent(ErrCodeSrc src, u16 fault)
+int ErrCodeFIFO_PushIfAbsentSev(ErrCodeSrc src, u16 fault, u8 sev)
 {
+	if (sev >= ERRFIFO_SEV_LEVELS) {sev = ERRFIFO_SEV_LEVELS - 1;}
+
 	u32 pm = _errfifo_enter();
 
 	// 查重
-	u16 i = 0U;
-	u16 idx = s_fifo.tail;
-	for (i = 0U; i < s_fifo.count; i++)
+#if ERRFIFO_COALESCE
+	if (_coalesce((u8)src, fault))
 	{
-		const ErrCodeFifoItem_t *it = &s_fifo.buf[idx];
-		if ((it->src == (u8)src) && (it->fault == fault))
-		{
-			_errfifo_exit(pm);
-			return 0;
-		}
-		idx = _inc(idx);
+		_seal_hdr();
+		_errfifo_exit(pm);
+		return 0;
+	}
+#else
+	if (_find((u8)src, fault) >= 0)
+	{
+		_errfifo_exit(pm);
+		return 0;
 	}
+#endif
 
-	if (s_fifo.count == ERRFIFO_CAPACITY)
+	if ((s_fifo.count == ERRFIFO_CAPACITY) && (_evict(sev) == 0))
 	{
-#if ERRFIFO_OVERWRITE_ON_FULL
-		s_fifo.tail = _inc(s_fifo.tail);
-		s_fifo.count--;
-#else
 		_errfifo_exit(pm);
 		return -1;
-#endif
 	}
 
-	ErrCodeFifoItem_t *item = &s_fifo.buf[s_fifo.head];
-	item->src   = (u8)src;
-	item->ts_ms = (s_get_time_ms ? s_get_time_ms() : 0);
-	item->fault = fault;
-
-	s_fifo.head = _inc(s_fifo.head);
-	s_fifo.count++;
+	_append((u8)src, fault, sev);
+	_seal_hdr();
 
 	_errfifo_exit(pm);
 	return 1;
 }
 
+/*
+***************************************************************************************
+* 函 数 名: ErrCodeFIFO_PushIfAbsent
+* 功能说明: 以ERRFIFO_SEV_DEFAULT等级查重入队，见ErrCodeFIFO_PushIfAbsentSev
+* 形   参: src - 错误来源；fault - 故障码(16位)
+* 返 回 值: 1 表示成功入队；0 表示已存在未入队；-1 表示队列满且被淘汰策略拒绝
+***************************************************************************************
+*/
+int ErrCodeFIFO_PushIfAbsent(ErrCodeSrc src, u16 fault)
+{
+	return ErrCodeFIFO_PushIfAbsentSev(src, fault, ERRFIFO_SEV_DEFAULT);
+}
+
+#if ERRFIFO_RETAIN
+/*
+***************************************************************************************
+* 函 数 名: ErrCodeFIFO_Recovered
+* 功能说明: 获取最近一次ErrCodeFIFO_Init从复位前接管的错误码条数
+* 形   参: 无
+* 返 回 值: 条数
+***************************************************************************************
+*/
+u16 ErrCodeFIFO_Recovered(void)
+{
+	return s_recovered;
+}
+#endif
+
+#if ERRFIFO_CS_STATS
+/*
+***************************************************************************************
+* 函 数 名: ErrCodeFIFO_CsStats
+* 功能说明: 获取临界区长度统计
+* 形   参: out - 输出统计
+* 返 回 值: 无
+***************************************************************************************
+*/
+void ErrCodeFIFO_CsStats(ErrCodeFifoCsStats_t *out)
+{
+	*out = s_cs_stats;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: ErrCodeFIFO_CsStatsReset
+* 功能说明: 清零临界区长度统计
+* 形   参: 无
+* 返 回 值: 无
+***************************************************************************************
+*/
+void ErrCodeFIFO_CsStatsReset(void)
+{
+	s_cs_stats.count = 0U;
+	s_cs_stats.max = 0U;
+	s_cs_stats.total = 0ULL;
+}
+#endif
+
+#if ERRFIFO_BENCH
+/*
+***************************************************************************************
+* 函 数 名: _bench_linear_contains
+* 功能说明: 旧的查重方式，临界区内线性扫描整个FIFO，作为基准对照
+* 形   参: src - 错误来源；fault - 故障码(16位)
+* 返 回 值: 1 表示存在；0 表示不存在
+***************************************************************************************
+*/
+static int _bench_linear_contains(u8 src, u16 fault)
+{
+	u32 pm = _errfifo_enter();
+
+	for (u8 lv = 0U; lv < ERRFIFO_SEV_LEVELS; lv++)
+	{
+		for (u16 idx = s_fifo.head[lv]; idx != ERRFIFO_NIL; idx = s_fifo.next[idx])
+		{
+			const ErrCodeFifoSlot_t *it = &s_fifo.buf[idx];
+			if ((it->src == src) && (it->fault == fault))
+			{
+				_errfifo_exit(pm);
+				return 1;
+			}
+		}
+	}
+
+	_errfifo_exit(pm);
+	return 0;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _bench_report
+* 功能说明: 输出一行CSV：容量,操作,次数,平均ns,最长ns
+* 形   参: op - 操作名
+* 返 回 值: 无
+***************************************************************************************
+*/
+static void _bench_report(const char *op)
+{
+	ErrCodeFifoCsStats_t st;
+	ErrCodeFIFO_CsStats(&st);
+	printf("%d,%s,%u,%llu,%u\r\n", ERRFIFO_CAPACITY, op, st.count,
+	       st.count ? st.total / st.count : 0ULL, st.max);
+	ErrCodeFIFO_CsStatsReset();
+}
+
+/*
+***************************************************************************************
+* 函 数 名: ErrCodeFIFO_Bench
+* 功能说明: 主机端基准：FIFO写满后测量各操作的临界区长度，查找不存在的键是线性扫描的最坏情况。
+*          容量是编译期常量，按不同ERRFIFO_CAPACITY分别编译运行即可得到临界区长度随容量的变化，如
+*          gcc -DERRFIFO_USE_CRITICAL=0 -DERRFIFO_CS_STATS=1 -DERRFIFO_BENCH=1 -DERRFIFO_BENCH_MAIN
+*              -DERRFIFO_CAPACITY=256 -I<工程头文件目录> errcode_fifo.c crc16.c
+* 形   参: loops - 每项操作的执行次数
+* 返 回 值: 无
+***************************************************************************************
+*/
+void ErrCodeFIFO_Bench(u32 loops)
+{
+	u32 n = 0U;
+	volatile int sink = 0;
+
+	ErrCodeFIFO_Init(0);
+	for (n = 0U; n < ERRFIFO_CAPACITY; n++)
+	{
+		ErrCodeFIFO_Push((ErrCodeSrc)(n & 0x7U), (u16)(n * 7U + 1U));
+	}
+
+	printf("capacity,op,count,avg_ns,max_ns\r\n");
+	ErrCodeFIFO_CsStatsReset();
+	for (n = 0U; n < loops; n++)
+	{
+		sink += _bench_linear_contains(0U, 0U);
+	}
+	_bench_report("linear_contains_miss");
+
+	for (n = 0U; n < loops; n++)
+	{
+		sink += ErrCodeFIFO_Contains((ErrCodeSrc)0, 0U);
+	}
+	_bench_report("contains_miss");
+
+	for (n = 0U; n < loops; n++)
+	{
+		sink += ErrCodeFIFO_Contains((ErrCodeSrc)(n % ERRFIFO_CAPACITY & 0x7U),
+		                             (u16)(n % ERRFIFO_CAPACITY * 7U + 1U));
+	}
+	_bench_report("contains_hit");
+
+	/*新旧错误码交替，FIFO保持满，覆盖和索引删除都在临界区内*/
+	for (n = 0U; n < loops; n++)
+	{
+		sink += ErrCodeFIFO_PushIfAbsent((ErrCodeSrc)(n & 0x7U), (u16)(n % (2U * ERRFIFO_CAPACITY)));
+	}
+	_bench_report("push_if_absent");
+
+	ErrCodeFifoItem_t item;
+	for (n = 0U; n < loops; n++)
+	{
+		if (ErrCodeFIFO_Pop(&item) == 0)
+		{
+			break;
+		}
+		ErrCodeFIFO_Push((ErrCodeSrc)item.src, item.fault);
+	}
+	_bench_report("pop_push");
+	(void)sink;
+}
 
+#if defined(ERRFIFO_BENCH_MAIN)
+int main(void)
+{
+	ErrCodeFIFO_Bench(100000U);
+	return 0;
+}
+#endif
+#endif
@@ -4,38 +4,139 @@
 #include "types.h"
 #include "user_def.h"
 
-#if 1
-/*占用16个字节*/
-typedef struct
-{
-	unsigned long long ts_ms;/*时间戳(ms)*/ 
-	u8  src;      /*故障码来源*/ 
-	u16 fault;    /*具体的故障码*/ 
-} ErrCodeFifoItem_t;
+/*1:合并模式，重复的(src,fault)只累加已有元素的次数并更新最后出现时间，不再占用新位置*/
+#ifndef ERRFIFO_COALESCE
+#define ERRFIFO_COALESCE 0
+#endif
+
+/*元素存储布局*/
+#define ERRFIFO_LAYOUT_ALIGNED	0	/*16字节对齐，64位时间戳*/
+#define ERRFIFO_LAYOUT_PACKED	1	/*12字节紧凑，但是非对其访问性能下降*/
+#define ERRFIFO_LAYOUT_COMPACT	2	/*8字节自然对齐，只存32位时间戳，出队时无损扩展为64位*/
+
+#ifndef ERRFIFO_LAYOUT
+#define ERRFIFO_LAYOUT ERRFIFO_LAYOUT_ALIGNED
+#endif
+
+/*
+ * RAM占用(FIFO + 查重索引)，每个元素:
+ *     元素本身   ALIGNED 16 / PACKED 12 / COMPACT 8 字节，合并模式ALIGNED 24字节
+ *     next       2字节(等级子队列/空闲链表)
+ *     seq        4字节，仅ERRFIFO_SEV_LEVELS > 1，COMPACT按时间戳排序，不需要
+ *     查重索引   8字节(2倍容量 x 4字节)，合并模式4字节，ERRFIFO_DUP_INDEX=0时没有
+ *     chk        2字节，仅ERRFIFO_RETAIN
+ * 另有44~48字节的头部。默认CAP=32、4个等级时:
+ *     ALIGNED 1008B，PACKED 876B，COMPACT 620B，COMPACT且ERRFIFO_DUP_INDEX=0 364B
+ * V1.0的单一环形队列32条为520B，同样的RAM下COMPACT不要索引可存47条，剩下的差距是next链接
+ */
+
+#if ERRFIFO_COALESCE && (ERRFIFO_LAYOUT == ERRFIFO_LAYOUT_COMPACT)
+#error "ERRFIFO_COALESCE needs count/last_ts_ms, which do not fit ERRFIFO_LAYOUT_COMPACT"
+#endif
+
+/*严重等级，数值越大越严重，保存在flags的高位*/
+#define ERRFIFO_SEV_INFO		0
+#define ERRFIFO_SEV_WARN		1
+#define ERRFIFO_SEV_ERROR		2
+#define ERRFIFO_SEV_CRITICAL	3
+
+#ifndef ERRFIFO_SEV_LEVELS
+#define ERRFIFO_SEV_LEVELS		4	/*等级数，1~8，每个等级一条子队列*/
+#endif
+#ifndef ERRFIFO_SEV_DEFAULT	/*ErrCodeFIFO_Push/PushIfAbsent使用的等级*/
+#if ERRFIFO_SEV_LEVELS > ERRFIFO_SEV_ERROR
+#define ERRFIFO_SEV_DEFAULT		ERRFIFO_SEV_ERROR
 #else
-/*占用11个字节，但是非对其访问性能下降*/
+#define ERRFIFO_SEV_DEFAULT		(ERRFIFO_SEV_LEVELS - 1)
+#endif
+#endif
+
+#if (ERRFIFO_SEV_LEVELS < 1) || (ERRFIFO_SEV_LEVELS > 8) || (ERRFIFO_SEV_DEFAULT >= ERRFIFO_SEV_LEVELS)
+#error "ERRFIFO_SEV_LEVELS must be 1..8 and ERRFIFO_SEV_DEFAULT below it"
+#endif
+
+/*队列满时的淘汰策略*/
+#define ERRFIFO_EVICT_OLDEST	0	/*丢弃所有等级中最旧的元素*/
+#define ERRFIFO_EVICT_LOWEST	1	/*丢弃最低等级中最旧的元素，已有元素都比新元素等级高时拒绝新元素*/
+#define ERRFIFO_EVICT_REFUSE	2	/*拒绝新元素*/
+
+/*元素标志*/
+#define ERRFIFO_FLAG_GAP		0x01	/*队列满时覆盖过同等级更旧的元素，此条之前的历史不完整*/
+#define ERRFIFO_FLAG_SEV_SHIFT	4
+#define ERRFIFO_FLAG_SEV_MASK	0x70	/*严重等级*/
+/*0x0E在COMPACT布局中记录同一毫秒内的入队先后，出队时为0，不要另作他用*/
+#define ERRFIFO_ITEM_SEV(item)	(((item)->flags & ERRFIFO_FLAG_SEV_MASK) >> ERRFIFO_FLAG_SEV_SHIFT)
+
+#if ERRFIFO_LAYOUT == ERRFIFO_LAYOUT_PACKED
 #pragma pack(1)
+#endif
+/*出队的元素。ALIGNED占用16个字节，合并模式下24个字节；PACKED占用12个字节；
+  COMPACT下FIFO内部按8字节存储，出队时还原成本结构*/
 typedef struct
 {
-	unsigned long long ts_ms;/*时间戳(ms)*/ 
+	unsigned long long ts_ms;/*时间戳(ms)，合并模式下为首次出现时间*/ 
 	u8  src;      /*故障码来源*/ 
+	u8  flags;    /*ERRFIFO_FLAG_xxx和严重等级*/ 
 	u16 fault;    /*具体的故障码*/ 
+#if ERRFIFO_COALESCE
+	u16 count;    /*出现次数，饱和于0xFFFF*/ 
+	u32 last_ts_ms; /*最后一次出现的时间戳(ms)*/ 
+#endif
 } ErrCodeFifoItem_t;
+#if ERRFIFO_LAYOUT == ERRFIFO_LAYOUT_PACKED
 #pragma pack()
 #endif
 
 
 
+/*1:FIFO放在复位后不清零的RAM段中，用魔数和CRC校验，ErrCodeFIFO_Init时接管复位前未写入Flash的错误码*/
+#ifndef ERRFIFO_RETAIN
+#define ERRFIFO_RETAIN 0
+#endif
+
+/*1:统计临界区长度，目标板上单位为CPU周期(DWT)，主机上为ns*/
+#ifndef ERRFIFO_CS_STATS
+#define ERRFIFO_CS_STATS 0
+#endif
+
+/*1:编译主机端基准测试ErrCodeFIFO_Bench，需同时ERRFIFO_USE_CRITICAL=0、ERRFIFO_CS_STATS=1*/
+#ifndef ERRFIFO_BENCH
+#define ERRFIFO_BENCH 0
+#endif
+
+/*临界区长度统计*/
+typedef struct
+{
+	u32 count;                 /*临界区次数*/
+	u32 max;                   /*最长一次*/
+	unsigned long long total;  /*累计时长*/
+} ErrCodeFifoCsStats_t;
+
 typedef u32 (*ErrCodeGetTimeMsFn)(void);   // 获取当前时间的回调
 
 void ErrCodeFIFO_Init(ErrCodeGetTimeMsFn get_time_ms);
-int  ErrCodeFIFO_Push(ErrCodeSrc src, u16 fault);             // 0:OK, -1:满且不覆盖
+void ErrCodeFIFO_SetEvictPolicy(u8 policy);                   // ERRFIFO_EVICT_xxx
+int  ErrCodeFIFO_Push(ErrCodeSrc src, u16 fault);             // 0:OK(合并模式下含已合并), -1:满且被策略拒绝
+int  ErrCodeFIFO_PushSev(ErrCodeSrc src, u16 fault, u8 sev);  // 同上，指定严重等级
 int  ErrCodeFIFO_Pop(ErrCodeFifoItem_t *out);                 // 1:弹出, 0:空
+u16  ErrCodeFIFO_PopBatch(ErrCodeFifoItem_t *out, u16 max);    // 弹出的条数, 0:空
 int  ErrCodeFIFO_Peek(ErrCodeFifoItem_t *out);                // 1:有,   0:空
 int  ErrCodeFIFO_IsEmpty(void);                               // 1:空
 int  ErrCodeFIFO_IsFull(void);                                // 1:满
 u16  ErrCodeFIFO_Size(void);                                  // 当前数量
 int  ErrCodeFIFO_Contains(ErrCodeSrc src, u16 fault);         // 1:存在, 0:不存在
-int  ErrCodeFIFO_PushIfAbsent(ErrCodeSrc src, u16 fault);     // 1:入队, 0:已存在, -1:满未入队
+int  ErrCodeFIFO_PushIfAbsent(ErrCodeSrc src, u16 fault);     // 1:入队, 0:已存在(合并模式下已累加次数), -1:满未入队
+int  ErrCodeFIFO_PushIfAbsentSev(ErrCodeSrc src, u16 fault, u8 sev);
+u16  ErrCodeFIFO_SizeSev(u8 sev);                             // 某一等级的数量
+#if ERRFIFO_RETAIN
+u16  ErrCodeFIFO_Recovered(void);                             // 最近一次Init接管的条数
+#endif
+#if ERRFIFO_CS_STATS
+void ErrCodeFIFO_CsStats(ErrCodeFifoCsStats_t *out);
+void ErrCodeFIFO_CsStatsReset(void);
+#endif
+#if ERRFIFO_BENCH
+void ErrCodeFIFO_Bench(u32 loops);
+#endif
 
 #endif
@@ -0,0 +1,325 @@
+/*
+*********************************************************************************************************
+*
+*   模块名称 : 通用FIFO模块
+*   文件名称 : fifo.c
+*   版    本 : V1.0
+*   说    明 : 元素大小和容量在定义实例时确定的环形队列，容量为2的幂，下标用掩码计算；
+*              临界区和满时覆盖/拒绝策略与错误码FIFO一致，可在中断和主循环之间传递CAN报文、采样值等
+*   修改记录 :
+*       版本号  	日期        作者     	说明
+*       V1.0    2026-10-18 agent     	实现基本功能
+*
+*********************************************************************************************************
+*/
+
+#include <string.h>
+#include "fifo.h"
+
+#if FIFO_USE_CRITICAL
+#include "critical.h"
+#define _fifo_enter()		Critical_Enter()
+#define _fifo_exit(pm)		Critical_Exit(pm)
+#else
+static inline u32 _fifo_enter(void) { return 0U; }
+static inline void _fifo_exit(u32 pm) { (void)pm; }
+#endif
+
+/*
+***************************************************************************************
+* 函 数 名: _fifo_slot
+* 功能说明: 计数对应的元素地址
+* 形   参: fifo - FIFO实例；n - head或tail计数
+* 返 回 值: 元素地址
+***************************************************************************************
+*/
+static inline u8 *_fifo_slot(const Fifo_t *fifo, u16 n)
+{
+	return fifo->buf + (u32)(n & fifo->mask) * fifo->elem_size;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _fifo_copy_in
+* 功能说明: 从计数pos开始写入n个元素，跨过存储区末尾时分两段拷贝
+* 形   参: fifo - FIFO实例；pos - 起始计数；src - 源数据；n - 元素个数，不超过容量
+* 返 回 值: 无
+***************************************************************************************
+*/
+static void _fifo_copy_in(Fifo_t *fifo, u16 pos, const u8 *src, u16 n)
+{
+	u16 off = pos & fifo->mask;
+	u16 first = (u16)(fifo->mask + 1U - off);
+	if (first > n)
+	{
+		first = n;
+	}
+	memcpy(_fifo_slot(fifo, pos), src, (u32)first * fifo->elem_size);
+	if (n > first)
+	{
+		memcpy(fifo->buf, src + (u32)first * fifo->elem_size, (u32)(n - first) * fifo->elem_size);
+	}
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _fifo_copy_out
+* 功能说明: 从计数pos开始读出n个元素，跨过存储区末尾时分两段拷贝
+* 形   参: fifo - FIFO实例；pos - 起始计数；dst - 目标缓冲；n - 元素个数，不超过当前数量
+* 返 回 值: 无
+***************************************************************************************
+*/
+static void _fifo_copy_out(const Fifo_t *fifo, u16 pos, u8 *dst, u16 n)
+{
+	u16 off = pos & fifo->mask;
+	u16 first = (u16)(fifo->mask + 1U - off);
+	if (first > n)
+	{
+		first = n;
+	}
+	memcpy(dst, _fifo_slot(fifo, pos), (u32)first * fifo->elem_size);
+	if (n > first)
+	{
+		memcpy(dst + (u32)first * fifo->elem_size, fifo->buf, (u32)(n - first) * fifo->elem_size);
+	}
+}
+
+/*
+***************************************************************************************
+* 函 数 名: FIFO_Push
+* 功能说明: 写入一个元素，满时按实例的策略覆盖最旧元素或拒绝
+* 形   参: fifo - FIFO实例；item - 待写入的元素
+* 返 回 值: 0 表示成功；-1 表示队列已满且未配置覆盖
+***************************************************************************************
+*/
+int FIFO_Push(Fifo_t *fifo, const void *item)
+{
+	u32 pm = _fifo_enter();
+
+	if ((u16)(fifo->head - fifo->tail) > fifo->mask)
+	{
+		fifo->dropped++;
+		if (fifo->overwrite == 0U)
+		{
+			_fifo_exit(pm);
+			return -1;
+		}
+		fifo->tail++;
+	}
+
+	fifo->copy(_fifo_slot(fifo, fifo->head), item);
+	fifo->head++;
+
+	_fifo_exit(pm);
+	return 0;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: FIFO_Pop
+* 功能说明: 弹出最旧的元素
+* 形   参: fifo - FIFO实例；out - 接收弹出的元素
+* 返 回 值: 1 表示成功弹出；0 表示队列为空
+***************************************************************************************
+*/
+int FIFO_Pop(Fifo_t *fifo, void *out)
+{
+	u32 pm = _fifo_enter();
+
+	if (fifo->head == fifo->tail)
+	{
+		_fifo_exit(pm);
+		return 0;
+	}
+
+	fifo->copy(out, _fifo_slot(fifo, fifo->tail));
+	fifo->tail++;
+
+	_fifo_exit(pm);
+	return 1;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: FIFO_Peek
+* 功能说明: 查看最旧的元素但不弹出
+* 形   参: fifo - FIFO实例；out - 接收查看到的元素
+* 返 回 值: 1 表示存在元素；0 表示队列为空
+***************************************************************************************
+*/
+int FIFO_Peek(Fifo_t *fifo, void *out)
+{
+	u32 pm = _fifo_enter();
+
+	if (fifo->head == fifo->tail)
+	{
+		_fifo_exit(pm);
+		return 0;
+	}
+
+	fifo->copy(out, _fifo_slot(fifo, fifo->tail));
+
+	_fifo_exit(pm);
+	return 1;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: FIFO_PushBatch
+* 功能说明: 在一次临界区内写入n个连续存放的元素。空间不足时，覆盖模式丢弃最旧的元素
+*          (n超过容量时只保留最后容量个)，拒绝模式只写入放得下的前几个
+* 形   参: fifo - FIFO实例；items - 元素数组；n - 元素个数
+* 返 回 值: 写入的元素个数
+***************************************************************************************
+*/
+u16 FIFO_PushBatch(Fifo_t *fifo, const void *items, u16 n)
+{
+	const u8 *src = (const u8 *)items;
+	u16 cap = (u16)(fifo->mask + 1U);
+
+	u32 pm = _fifo_enter();
+
+	u16 space = (u16)(cap - (u16)(fifo->head - fifo->tail));
+	if (n > space)
+	{
+		if (fifo->overwrite == 0U)
+		{
+			fifo->dropped += (u32)(n - space);
+			n = space;
+		}
+		else
+		{
+			if (n > cap)
+			{
+				fifo->dropped += (u32)(n - cap);
+				src += (u32)(n - cap) * fifo->elem_size;
+				n = cap;
+			}
+			if (n > space)
+			{
+				fifo->dropped += (u32)(n - space);
+				fifo->tail = (u16)(fifo->tail + (n - space));
+			}
+		}
+	}
+
+	if (n > 0U)
+	{
+		_fifo_copy_in(fifo, fifo->head, src, n);
+		fifo->head = (u16)(fifo->head + n);
+	}
+
+	_fifo_exit(pm);
+	return n;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: FIFO_PopBatch
+* 功能说明: 在一次临界区内弹出最多max个元素，连续存放到out
+* 形   参: fifo - FIFO实例；out - 输出数组，至少能容纳max个元素；max - 最多弹出的个数
+* 返 回 值: 实际弹出的个数，0 表示队列为空
+***************************************************************************************
+*/
+u16 FIFO_PopBatch(Fifo_t *fifo, void *out, u16 max)
+{
+	if ((out == 0) || (max == 0U)) {return 0;}
+
+	u32 pm = _fifo_enter();
+
+	u16 n = (u16)(fifo->head - fifo->tail);
+	if (n > max)
+	{
+		n = max;
+	}
+	if (n > 0U)
+	{
+		_fifo_copy_out(fifo, fifo->tail, (u8 *)out, n);
+		fifo->tail = (u16)(fifo->tail + n);
+	}
+
+	_fifo_exit(pm);
+	return n;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: FIFO_Size
+* 功能说明: 获取当前已存放的元素个数
+* 形   参: fifo - FIFO实例
+* 返 回 值: 元素个数
+***************************************************************************************
+*/
+u16 FIFO_Size(const Fifo_t *fifo)
+{
+	return (u16)(fifo->head - fifo->tail);
+}
+
+/*
+***************************************************************************************
+* 函 数 名: FIFO_Capacity
+* 功能说明: 获取容量
+* 形   参: fifo - FIFO实例
+* 返 回 值: 容量
+***************************************************************************************
+*/
+u16 FIFO_Capacity(const Fifo_t *fifo)
+{
+	return (u16)(fifo->mask + 1U);
+}
+
+/*
+***************************************************************************************
+* 函 数 名: FIFO_IsEmpty
+* 功能说明: 判断是否为空
+* 形   参: fifo - FIFO实例
+* 返 回 值: 1 表示空，0 表示非空
+***************************************************************************************
+*/
+int FIFO_IsEmpty(const Fifo_t *fifo)
+{
+	return (fifo->head == fifo->tail) ? 1 : 0;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: FIFO_IsFull
+* 功能说明: 判断是否已满
+* 形   参: fifo - FIFO实例
+* 返 回 值: 1 表示满，0 表示未满
+***************************************************************************************
+*/
+int FIFO_IsFull(const Fifo_t *fifo)
+{
+	return ((u16)(fifo->head - fifo->tail) > fifo->mask) ? 1 : 0;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: FIFO_Dropped
+* 功能说明: 获取满时被覆盖或被拒绝的元素个数
+* 形   参: fifo - FIFO实例
+* 返 回 值: 元素个数
+***************************************************************************************
+*/
+u32 FIFO_Dropped(const Fifo_t *fifo)
+{
+	return fifo->dropped;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: FIFO_Clear
+* 功能说明: 清空队列和丢弃计数
+* 形   参: fifo - FIFO实例
+* 返 回 值: 无
+***************************************************************************************
+*/
+void FIFO_Clear(Fifo_t *fifo)
+{
+	u32 pm = _fifo_enter();
+	fifo->head = 0U;
+	fifo->tail = 0U;
+	fifo->dropped = 0U;
+	_fifo_exit(pm);
+}
@@ -0,0 +1,53 @@
+#ifndef __FIFO_H__
+#define __FIFO_H__
+
+#include "types.h"
+
+/*1:操作时屏蔽中断(PRIMASK)，中断和主循环可同时访问同一实例*/
+#ifndef FIFO_USE_CRITICAL
+#define FIFO_USE_CRITICAL 1
+#endif
+
+typedef void (*FifoCopyFn)(void *dst, const void *src);   // 单个元素的拷贝，由FIFO_DEFINE按元素类型生成
+
+/*定长元素的环形队列。head/tail为自由递增的计数，下标取低位(& mask)，
+  元素个数为head - tail，容量必须是2的幂且不超过32768*/
+typedef struct
+{
+	u8  *buf;         /*元素存储区*/
+	u16 elem_size;    /*元素大小*/
+	u16 mask;         /*容量-1*/
+	u8  overwrite;    /*1:满时覆盖最旧元素，0:满时拒绝新元素*/
+	FifoCopyFn copy;
+	u16 head;         /*已写入的元素计数*/
+	u16 tail;         /*已取出的元素计数*/
+	u32 dropped;      /*被覆盖或被拒绝的元素个数*/
+} Fifo_t;
+
+/*
+ * 定义一个FIFO实例，存储区静态分配，无需初始化即可使用，例如
+ *     FIFO_DEFINE(g_can_rx_fifo, CanRxMsg, 64, 0);
+ * 其他文件中用FIFO_DECLARE(g_can_rx_fifo)引用
+ */
+#define FIFO_DEFINE(name, type, cap, ovw)                                                       \
+	typedef char name##_cap_must_be_pow2[((((cap) & ((cap) - 1)) == 0) && ((cap) >= 2)         \
+	                                      && ((cap) <= 32768)) ? 1 : -1];                        \
+	static type name##_buf[cap];                                                                 \
+	static void name##_copy(void *dst, const void *src) { *(type *)dst = *(const type *)src; }  \
+	Fifo_t name = { (u8 *)name##_buf, (u16)sizeof(type), (u16)((cap) - 1), (ovw), name##_copy, 0, 0, 0 }
+
+#define FIFO_DECLARE(name)	extern Fifo_t name
+
+int  FIFO_Push(Fifo_t *fifo, const void *item);               // 0:OK(满时可能覆盖了最旧元素), -1:满未入队
+int  FIFO_Pop(Fifo_t *fifo, void *out);                       // 1:弹出, 0:空
+int  FIFO_Peek(Fifo_t *fifo, void *out);                      // 1:有,   0:空
+u16  FIFO_PushBatch(Fifo_t *fifo, const void *items, u16 n);  // 写入的个数
+u16  FIFO_PopBatch(Fifo_t *fifo, void *out, u16 max);         // 弹出的个数, 0:空
+u16  FIFO_Size(const Fifo_t *fifo);                           // 当前数量
+u16  FIFO_Capacity(const Fifo_t *fifo);                       // 容量
+int  FIFO_IsEmpty(const Fifo_t *fifo);                        // 1:空
+int  FIFO_IsFull(const Fifo_t *fifo);                         // 1:满
+u32  FIFO_Dropped(const Fifo_t *fifo);                        // 被覆盖或被拒绝的元素个数
+void FIFO_Clear(Fifo_t *fifo);
+
+#endif
@@ -1,6 +1,7 @@
 #include "hal_rng.h"
 #include "stdbool.h"
 #include <stdio.h>
+#include <string.h>
 
 /*
  *实际使用中使用xrngBufPut和xrngPut只能存储buflen-1个数据
@@ -12,7 +13,56 @@ RING_ID rngInit(T_Ring *ring ,char *buffer, int bufLen)
 	ring->capaticy = bufLen;
 	ring->fromBuf   = 0;
 	ring->toBuf	 = 0;
-	return (int)ring;
+	return (RING_ID)ring;
+}
+
+/*
+ * 从ring的from位置开始拷贝len个数据到buf，跨过缓冲区末尾时分两段memcpy，不修改ring
+ * 调用者保证len不超过ring中的数据量
+ */
+static void rngCopyOut(const T_Ring *_ring, int from, char *buf, int len)
+{
+    int first = _ring->capaticy - from;
+    if(first > len)
+    {
+        first = len;
+    }
+    memcpy(buf, &_ring->pBuf[from], first);
+    if(len > first)
+    {
+        memcpy(buf + first, _ring->pBuf, len - first);
+    }
+}
+
+/*
+ * 把buf中len个数据拷贝到ring的to位置开始的空间，跨过缓冲区末尾时分两段memcpy，不修改ring
+ * 调用者保证len不超过ring的剩余空间
+ */
+static void rngCopyIn(T_Ring *_ring, int to, const char *buf, int len)
+{
+    int first = _ring->capaticy - to;
+    if(first > len)
+    {
+        first = len;
+    }
+    memcpy(&_ring->pBuf[to], buf, first);
+    if(len > first)
+    {
+        memcpy(_ring->pBuf, buf + first, len - first);
+    }
+}
+
+/*
+ * 索引向后移动n个位置，n不超过capaticy
+ */
+static int rngAdvance(const T_Ring *_ring, int idx, int n)
+{
+    idx += n;
+    if(idx >= _ring->capaticy)
+    {
+        idx -= _ring->capaticy;
+    }
+    return idx;
 }
 
 /*
@@ -43,36 +93,20 @@ bool rngGet(RING_ID ring, char* rcv)
 }
 
 /*
- * 从ring中拷贝数据，拷贝数据并不会是ring中的数据减少
+ * 从ring中拷贝第where个数据(从最早的数据算起，0开始)，拷贝数据并不会是ring中的数据减少，
+ * 直接计算下标，耗时与where无关
  * 返回 1：读取成功
- * 返回 0：读取失败，ring已经空了
+ * 返回 0：读取失败，ring中没有第where个数据
  */
 bool rngCpy(RING_ID ring, int where, char* rcv)
 {
-    int fromBuf , i=0;
-    bool ret = false;
     T_Ring* _ring = (T_Ring*)ring;
-    if(_ring == NULL)
-    {
-        return ret;
-    }
-    fromBuf = _ring->fromBuf;
-    while(fromBuf  != _ring->toBuf)
+    if(_ring == NULL || where < 0 || where >= rngLen(ring))
     {
-        if( i == where)
-        {
-            *rcv = _ring->pBuf[_ring->fromBuf];
-            ret = true;
-            break;
-        }
-        i++;
-        fromBuf++;
-        if(fromBuf >= _ring->capaticy)
-        {
-            fromBuf = 0;
-        }
+        return false;
     }
-    return ret;
+    *rcv = _ring->pBuf[rngAdvance(_ring, _ring->fromBuf, where)];
+    return true;
 }
 
 /*
@@ -81,26 +115,20 @@ bool rngCpy(RING_ID ring, int where, char* rcv)
  */
 int rngBufCpy(RING_ID ring , char* buf, int bufLen)
 {
-    int fromBuf = 0, i=0;
+    int min;
     T_Ring* _ring = (T_Ring*)ring;
-    if(_ring == NULL)
+    if(_ring == NULL || bufLen <= 0)
     {
         return 0;
     }
     
-    fromBuf = _ring->fromBuf;
-    while(fromBuf != _ring->toBuf)
-    {
-        if(i<bufLen)
-            buf[i++] = _ring->pBuf[_ring->fromBuf++];
-        else
-            break;
-        if(fromBuf >= _ring->capaticy)
-        {
-            fromBuf = 0;
-        }
+    min = rngLen(ring);
+    if(min > bufLen)
+    {
+        min = bufLen;
     }
-    return i;
+    rngCopyOut(_ring, _ring->fromBuf, buf, min); /*只读不移动fromBuf*/
+    return min;
 }
 
 /*
@@ -171,10 +199,9 @@ void rngPutForce(RING_ID ring, char val)
  */
 int rngBufGet(RING_ID ring, char*buf, int len)
 {
-	int i=0;
 	int min;
     T_Ring* _ring = (T_Ring*)ring;
-    if(_ring == NULL)
+    if(_ring == NULL || len <= 0)
     {
         return 0;
     }
@@ -186,15 +213,10 @@ int rngBufGet(RING_ID ring, char*buf, int len)
 		min = len;
 	}
 	
-    for(i=0; i< min; i++)
-    {
-        buf[i] = _ring->pBuf[_ring->fromBuf++];
-        if( _ring->fromBuf>=_ring->capaticy )
-        {
-            _ring->fromBuf = 0;
-        }
-    }
-	return i;
+    /*最多两段memcpy，拷贝完成后一次性更新fromBuf*/
+    rngCopyOut(_ring, _ring->fromBuf, buf, min);
+    _ring->fromBuf = rngAdvance(_ring, _ring->fromBuf, min);
+	return min;
 }
 
 /*
@@ -203,10 +225,9 @@ int rngBufGet(RING_ID ring, char*buf, int len)
  */
 int rngBufPut(RING_ID ring, char*buf, int len)
 {
-	int i=0;
     int min;
     T_Ring* _ring = (T_Ring*)ring;
-    if(_ring == NULL)
+    if(_ring == NULL || len <= 0)
     {
         return 0;
     }
@@ -218,15 +239,10 @@ int rngBufPut(RING_ID ring, char*buf, int len)
 		min = len;
 	}
 
-    for(i=0; i<min; i++)
-    {
-        _ring->pBuf[_ring->toBuf++] = buf[i];
-        if(_ring->toBuf >= _ring->capaticy)
-        {
-            _ring->toBuf = 0;
-        }
-    }
-	return i;
+    /*最多两段memcpy，数据写完后才更新toBuf，读端不会看到未写入的数据*/
+    rngCopyIn(_ring, _ring->toBuf, buf, min);
+    _ring->toBuf = rngAdvance(_ring, _ring->toBuf, min);
+	return min;
 }
 
 /*
@@ -292,3 +308,335 @@ void rngClear(RING_ID ring)
     }
 	_ring->toBuf = _ring->fromBuf = 0;
 }
+
+/*
+ * 预留ring中从toBuf开始的一段连续可写空间，数据直接写入*ppBuf后调用rngCommit提交，
+ * 提交前读端看不到这些数据。空间在缓冲区末尾回绕时只返回到末尾的部分，
+ * 需要更多空间时可先提交再预留一次
+ * 返回：可写的连续字节数(不超过len)，0表示ring已满
+ */
+int rngReserve(RING_ID ring, char **ppBuf, int len)
+{
+    int space, contig;
+    T_Ring* _ring = (T_Ring*)ring;
+    if(_ring == NULL || ppBuf == NULL || len <= 0)
+    {
+        return 0;
+    }
+
+    space = (_ring->capaticy - rngLen(ring)) - 1;
+    contig = _ring->capaticy - _ring->toBuf;
+    if(space > contig)
+    {
+        space = contig;
+    }
+    if(space > len)
+    {
+        space = len;
+    }
+    *ppBuf = &_ring->pBuf[_ring->toBuf];
+    return space;
+}
+
+/*
+ * 提交rngReserve预留空间中实际写入的len个字节，len超过可写空间时按可写空间截断
+ * 返回：实际提交的字节数
+ */
+int rngCommit(RING_ID ring, int len)
+{
+    int space;
+    T_Ring* _ring = (T_Ring*)ring;
+    if(_ring == NULL || len <= 0)
+    {
+        return 0;
+    }
+
+    space = (_ring->capaticy - rngLen(ring)) - 1;
+    if(len > space)
+    {
+        len = space;
+    }
+    _ring->toBuf = rngAdvance(_ring, _ring->toBuf, len);
+    return len;
+}
+
+/*
+ * 获取ring中可读数据所在的连续区域，数据回绕时分为两段，否则第二段长度为0，
+ * 读完后调用rngConsume释放。ppBuf2/pLen2可为NULL，此时只返回第一段
+ * 返回：两段的总长度
+ */
+int rngGetRegions(RING_ID ring, char **ppBuf1, int *pLen1, char **ppBuf2, int *pLen2)
+{
+    int len, first;
+    T_Ring* _ring = (T_Ring*)ring;
+    if(_ring == NULL || ppBuf1 == NULL || pLen1 == NULL)
+    {
+        return 0;
+    }
+
+    len = rngLen(ring);
+    first = _ring->capaticy - _ring->fromBuf;
+    if(first > len)
+    {
+        first = len;
+    }
+    *ppBuf1 = &_ring->pBuf[_ring->fromBuf];
+    *pLen1 = first;
+    if(ppBuf2 == NULL || pLen2 == NULL)
+    {
+        return first;
+    }
+    *ppBuf2 = _ring->pBuf;
+    *pLen2 = len - first;
+    return len;
+}
+
+/*
+ * 丢弃ring中最早的len个字节，配合rngGetRegions使用，len超过数据量时按数据量截断
+ * 返回：实际丢弃的字节数
+ */
+int rngConsume(RING_ID ring, int len)
+{
+    int used;
+    T_Ring* _ring = (T_Ring*)ring;
+    if(_ring == NULL || len <= 0)
+    {
+        return 0;
+    }
+
+    used = rngLen(ring);
+    if(len > used)
+    {
+        len = used;
+    }
+    _ring->fromBuf = rngAdvance(_ring, _ring->fromBuf, len);
+    return len;
+}
+
+/*
+ * SPSC ring的索引访问：读对端索引用acquire，发布本端索引用release，
+ * 保证数据先于索引对另一端可见。Cortex-M3单核上即编译器屏障加DMB
+ */
+#if defined(__CC_ARM)
+static __inline unsigned rngLoadAcquire(volatile unsigned *p)
+{
+    unsigned v = *p;
+    __dmb(0xF);
+    return v;
+}
+
+static __inline void rngStoreRelease(volatile unsigned *p, unsigned v)
+{
+    __dmb(0xF);
+    *p = v;
+}
+#else
+static inline unsigned rngLoadAcquire(volatile unsigned *p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void rngStoreRelease(volatile unsigned *p, unsigned v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+#endif
+
+/*
+ * 初始化SPSC ring，bufLen必须是2的幂
+ * 返回 true：成功
+ * 返回 false：参数错误
+ */
+bool rngSpscInit(T_SpscRing *ring, char *buffer, int bufLen)
+{
+    if(ring == NULL || buffer == NULL || bufLen < 2 || (bufLen & (bufLen - 1)) != 0)
+    {
+        return false;
+    }
+    ring->pBuf = buffer;
+    ring->mask = (unsigned)bufLen - 1U;
+    ring->head = 0;
+    ring->tail = 0;
+    return true;
+}
+
+/*
+ * 写端：写入一个字节
+ * 返回 true：写入成功
+ * 返回 false：ring已满
+ */
+bool rngSpscPut(T_SpscRing *ring, char val)
+{
+    unsigned head = ring->head;
+    if(head - rngLoadAcquire(&ring->tail) > ring->mask)
+    {
+        return false;
+    }
+    ring->pBuf[head & ring->mask] = val;
+    rngStoreRelease(&ring->head, head + 1U);
+    return true;
+}
+
+/*
+ * 读端：读取一个字节
+ * 返回 true：读取成功
+ * 返回 false：ring为空
+ */
+bool rngSpscGet(T_SpscRing *ring, char *rcv)
+{
+    unsigned tail = ring->tail;
+    if(rngLoadAcquire(&ring->head) == tail)
+    {
+        return false;
+    }
+    *rcv = ring->pBuf[tail & ring->mask];
+    rngStoreRelease(&ring->tail, tail + 1U);
+    return true;
+}
+
+/*
+ * 写端：写入一组数据，最多两段memcpy，写入的长度可能小于len
+ * 返回：实际写入的数据长度
+ */
+int rngSpscBufPut(T_SpscRing *ring, const char *buf, int len)
+{
+    unsigned head = ring->head;
+    unsigned space = ring->mask + 1U - (head - rngLoadAcquire(&ring->tail));
+    unsigned off = head & ring->mask;
+    unsigned first;
+
+    if(len <= 0)
+    {
+        return 0;
+    }
+    if((unsigned)len < space)
+    {
+        space = (unsigned)len;
+    }
+    first = ring->mask + 1U - off;
+    if(first > space)
+    {
+        first = space;
+    }
+    memcpy(&ring->pBuf[off], buf, first);
+    memcpy(ring->pBuf, buf + first, space - first);
+    rngStoreRelease(&ring->head, head + space);
+    return (int)space;
+}
+
+/*
+ * 读端：读取一组数据，最多两段memcpy，实际读取的长度可能小于len
+ * 返回：实际读取的数据长度
+ */
+int rngSpscBufGet(T_SpscRing *ring, char *buf, int len)
+{
+    unsigned tail = ring->tail;
+    unsigned used = rngLoadAcquire(&ring->head) - tail;
+    unsigned off = tail & ring->mask;
+    unsigned first;
+
+    if(len <= 0)
+    {
+        return 0;
+    }
+    if((unsigned)len < used)
+    {
+        used = (unsigned)len;
+    }
+    first = ring->mask + 1U - off;
+    if(first > used)
+    {
+        first = used;
+    }
+    memcpy(buf, &ring->pBuf[off], first);
+    memcpy(buf + first, ring->pBuf, used - first);
+    rngStoreRelease(&ring->tail, tail + used);
+    return (int)used;
+}
+
+/*
+ * 获取ring中的数据个数，在任意一端调用都是某一时刻的快照
+ */
+int rngSpscLen(T_SpscRing *ring)
+{
+    unsigned tail = rngLoadAcquire(&ring->tail);
+    return (int)(rngLoadAcquire(&ring->head) - tail);
+}
+
+/*
+ * 从第offset个数据开始查找字节val，数据在ring中分为至多两段，每段用memchr查找
+ * 返回：val相对最早数据的位置，-1表示未找到
+ */
+int rngFind(RING_ID ring, int offset, char val)
+{
+    int len, first, pos;
+    const char *hit;
+    T_Ring* _ring = (T_Ring*)ring;
+    if(_ring == NULL || offset < 0)
+    {
+        return -1;
+    }
+
+    len = rngLen(ring);
+    if(offset >= len)
+    {
+        return -1;
+    }
+    first = _ring->capaticy - _ring->fromBuf; /*第一段的长度*/
+    if(first > len)
+    {
+        first = len;
+    }
+    if(offset < first)
+    {
+        hit = memchr(&_ring->pBuf[_ring->fromBuf + offset], val, first - offset);
+        if(hit != NULL)
+        {
+            return (int)(hit - &_ring->pBuf[_ring->fromBuf]);
+        }
+        offset = first;
+    }
+    pos = offset - first; /*第二段从pBuf[0]开始*/
+    hit = memchr(&_ring->pBuf[pos], val, len - offset);
+    if(hit != NULL)
+    {
+        return first + (int)(hit - _ring->pBuf);
+    }
+    return -1;
+}
+
+/*
+ * 从第offset个数据开始查找长度为patLen的字节序列，匹配可以跨过缓冲区末尾。
+ * 先用rngFind定位首字节，再逐段比较其余字节
+ * 返回：序列首字节相对最早数据的位置，-1表示未找到
+ */
+int rngFindPattern(RING_ID ring, int offset, const char *pat, int patLen)
+{
+    int len, pos, idx, first;
+    T_Ring* _ring = (T_Ring*)ring;
+    if(_ring == NULL || pat == NULL || patLen <= 0)
+    {
+        return -1;
+    }
+
+    len = rngLen(ring);
+    while((pos = rngFind(ring, offset, pat[0])) >= 0 && pos + patLen <= len)
+    {
+        idx = rngAdvance(_ring, _ring->fromBuf, pos);
+        first = _ring->capaticy - idx;
+        if(first >= patLen)
+        {
+            if(memcmp(&_ring->pBuf[idx], pat, patLen) == 0)
+            {
+                return pos;
+            }
+        }
+        else if(memcmp(&_ring->pBuf[idx], pat, first) == 0
+                && memcmp(_ring->pBuf, pat + first, patLen - first) == 0)
+        {
+            return pos;
+        }
+        offset = pos + 1;
+    }
+    return -1;
+}
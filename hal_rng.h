@@ -14,7 +14,19 @@ typedef struct
 
 }T_Ring;
 
-typedef int RING_ID;
+typedef intptr_t RING_ID;	/*保存T_Ring指针，与指针同宽，64位主机上不截断*/
+
+/*
+ * 单生产者单消费者ring：容量为2的幂，head/tail自由递增，用掩码取下标，可存满capacity个数据。
+ * head只由写端修改，tail只由读端修改，两端各自一个上下文(如中断写、主循环读)时无需关中断
+ */
+typedef struct
+{
+	char *pBuf;
+	unsigned mask;				/*容量-1*/
+	volatile unsigned head;		/*已写入的字节计数*/
+	volatile unsigned tail;		/*已读出的字节计数*/
+}T_SpscRing;
 
 RING_ID rngInit(T_Ring *ring ,char *buffer, int bufLen);
 bool rngGet(RING_ID ring, char* rcv);
@@ -29,4 +41,21 @@ bool rngIsFull(RING_ID ring);
 bool rngIsEmpty(RING_ID ring);
 void rngClear(RING_ID ring); 
 
+/*原地读写：写端在ring内直接生成数据，读端(如DMA)直接从ring内取数据，不经过中间缓冲*/
+int rngReserve(RING_ID ring, char **ppBuf, int len);
+int rngCommit(RING_ID ring, int len);
+int rngGetRegions(RING_ID ring, char **ppBuf1, int *pLen1, char **ppBuf2, int *pLen2);
+int rngConsume(RING_ID ring, int len);
+
+/*原地解析：查找从第offset个数据开始的字节/字节序列，返回相对最早数据的位置，-1:未找到*/
+int rngFind(RING_ID ring, int offset, char val);
+int rngFindPattern(RING_ID ring, int offset, const char *pat, int patLen);
+
+bool rngSpscInit(T_SpscRing *ring, char *buffer, int bufLen);
+bool rngSpscPut(T_SpscRing *ring, char val);
+bool rngSpscGet(T_SpscRing *ring, char *rcv);
+int rngSpscBufPut(T_SpscRing *ring, const char *buf, int len);
+int rngSpscBufGet(T_SpscRing *ring, char *buf, int len);
+int rngSpscLen(T_SpscRing *ring);
+
 #endif /*__LIB_RNG_H_*/
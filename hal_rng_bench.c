@@ -0,0 +1,413 @@
+#include "hal_rng.h"
+#include "hal_rng_bench.h"
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#define RNG_BENCH_MAX_CAP   4096
+#define RNG_BENCH_MAX_CHUNK 256
+
+static T_Ring s_bench_ring;
+static char s_bench_buf[RNG_BENCH_MAX_CAP];
+static char s_bench_src[RNG_BENCH_MAX_CHUNK];
+static char s_bench_dst[RNG_BENCH_MAX_CHUNK];
+static volatile int s_bench_sink;
+
+static const int s_bench_caps[] = {64, 256, 1024, 4096};
+static const int s_bench_chunks[] = {1, 7, 61, 255};
+
+#define RNG_BENCH_NUM(a)    ((int)(sizeof(a) / sizeof((a)[0])))
+
+static unsigned long long rngBenchNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+/*
+ * 对端未就绪时休眠一下，sched_yield在单核主机上让不出时间片
+ */
+static void rngBenchPause(void)
+{
+    struct timespec ts = {0, 1000};
+    nanosleep(&ts, NULL);
+}
+
+/*
+ * 输出CSV表头，rngBench和rngSpscBench共用一个表头，调用任何测试前输出一次
+ */
+void rngBenchHeader(void)
+{
+    printf("capacity,op,pattern,count,ps_per_op,errors\r\n");
+}
+
+/*
+ * 输出一行CSV，耗时折算为每次操作(或每字节)的ps
+ */
+static void rngBenchReport(int cap, const char *op, const char *pattern, long count,
+                           unsigned long long ns, long errors)
+{
+    printf("%d,%s,%s,%ld,%llu,%ld\r\n", cap, op, pattern, count,
+           ns * 1000ULL / (unsigned long long)count, errors);
+}
+
+/*
+ * 逐字节实现，作为批量拷贝的对照
+ */
+static int rngBenchBytePut(T_Ring *_ring, const char *buf, int len)
+{
+    int i;
+    int min = (_ring->capaticy - rngLen((RING_ID)_ring)) - 1;
+    if(min > len)
+    {
+        min = len;
+    }
+    for(i=0; i<min; i++)
+    {
+        _ring->pBuf[_ring->toBuf++] = buf[i];
+        if(_ring->toBuf >= _ring->capaticy)
+        {
+            _ring->toBuf = 0;
+        }
+    }
+    return i;
+}
+
+static int rngBenchByteGet(T_Ring *_ring, char *buf, int len)
+{
+    int i;
+    int min = rngLen((RING_ID)_ring);
+    if(min > len)
+    {
+        min = len;
+    }
+    for(i=0; i<min; i++)
+    {
+        buf[i] = _ring->pBuf[_ring->fromBuf++];
+        if(_ring->fromBuf >= _ring->capaticy)
+        {
+            _ring->fromBuf = 0;
+        }
+    }
+    return i;
+}
+
+/*
+ * 按chunk大小反复写入再读出，共搬运bytes个字节
+ * chunk与容量互质时读写位置会轮流落在缓冲区末尾，覆盖两段拷贝的情况
+ */
+static void rngBenchBulk(int cap, int chunk, int bytes, int bulk)
+{
+    char pattern[24];
+    RING_ID ring = rngInit(&s_bench_ring, s_bench_buf, cap);
+    int moved = 0;
+    unsigned long long t0 = rngBenchNs();
+    while(moved < bytes)
+    {
+        if(bulk)
+        {
+            rngBufPut(ring, s_bench_src, chunk);
+            moved += rngBufGet(ring, s_bench_dst, chunk);
+        }
+        else
+        {
+            rngBenchBytePut(&s_bench_ring, s_bench_src, chunk);
+            moved += rngBenchByteGet(&s_bench_ring, s_bench_dst, chunk);
+        }
+        s_bench_sink += s_bench_dst[0];
+    }
+    snprintf(pattern, sizeof(pattern), "chunk%d", chunk);
+    rngBenchReport(cap, bulk ? "buf_memcpy" : "buf_byte", pattern, moved, rngBenchNs() - t0, 0);
+}
+
+/*
+ * 单字节rngPut/rngGet：pingpong每写一个读一个，ring始终接近空；
+ * fill_drain写满再读空，读写位置走遍整个缓冲区
+ */
+static void rngBenchByte(int cap, int bytes)
+{
+    RING_ID ring = rngInit(&s_bench_ring, s_bench_buf, cap);
+    unsigned long long t0;
+    char c = 0;
+    int n, k;
+
+    t0 = rngBenchNs();
+    for(n=0; n<bytes; n++)
+    {
+        rngPut(ring, (char)n);
+        rngGet(ring, &c);
+        s_bench_sink += c;
+    }
+    rngBenchReport(cap, "put_get", "pingpong", bytes, rngBenchNs() - t0, 0);
+
+    t0 = rngBenchNs();
+    for(n=0; n<bytes; n+=cap-1)
+    {
+        for(k=0; k<cap-1; k++)
+        {
+            rngPut(ring, (char)k);
+        }
+        for(k=0; k<cap-1; k++)
+        {
+            rngGet(ring, &c);
+            s_bench_sink += c;
+        }
+    }
+    rngBenchReport(cap, "put_get", "fill_drain", n, rngBenchNs() - t0, 0);
+}
+
+/*
+ * rngLen：linear为toBuf>=fromBuf，wrapped为数据跨过缓冲区末尾
+ */
+static void rngBenchLen(int cap, int loops)
+{
+    RING_ID ring = rngInit(&s_bench_ring, s_bench_buf, cap);
+    unsigned long long t0;
+    int n;
+
+    s_bench_ring.fromBuf = 0;
+    s_bench_ring.toBuf = cap / 2;
+    t0 = rngBenchNs();
+    for(n=0; n<loops; n++)
+    {
+        s_bench_sink += rngLen(ring);
+    }
+    rngBenchReport(cap, "len", "linear", loops, rngBenchNs() - t0, 0);
+
+    s_bench_ring.fromBuf = cap - cap / 4;
+    s_bench_ring.toBuf = cap / 4;
+    t0 = rngBenchNs();
+    for(n=0; n<loops; n++)
+    {
+        s_bench_sink += rngLen(ring);
+    }
+    rngBenchReport(cap, "len", "wrapped", loops, rngBenchNs() - t0, 0);
+}
+
+/*
+ * rngPutForce：ring已满，每写一个字节都覆盖最旧的数据
+ */
+static void rngBenchPutForce(int cap, int bytes)
+{
+    RING_ID ring = rngInit(&s_bench_ring, s_bench_buf, cap);
+    unsigned long long t0;
+    int n;
+
+    for(n=0; n<cap; n++)
+    {
+        rngPutForce(ring, (char)n);
+    }
+    t0 = rngBenchNs();
+    for(n=0; n<bytes; n++)
+    {
+        rngPutForce(ring, (char)n);
+    }
+    s_bench_sink += rngLen(ring);
+    rngBenchReport(cap, "put_force", "full", bytes, rngBenchNs() - t0, 0);
+}
+
+/*
+ * 原地解析：rngCpy随机访问末尾附近的数据；ring中数据跨过缓冲区末尾且只有最后两个字节是
+ * 0xAA 0x55时，用rngFind/rngFindPattern从头查找，即查找的最坏情况
+ */
+static void rngBenchFind(int cap, int loops)
+{
+    RING_ID ring = rngInit(&s_bench_ring, s_bench_buf, cap);
+    static const char delim[2] = {(char)0xAA, (char)0x55};
+    unsigned long long t0;
+    char c = 0;
+    int n;
+
+    s_bench_ring.fromBuf = cap / 2;
+    s_bench_ring.toBuf = cap / 2 - 1;
+    for(n=0; n<cap; n++)
+    {
+        s_bench_buf[n] = 0;
+    }
+    s_bench_buf[cap / 2 - 3] = delim[0];
+    s_bench_buf[cap / 2 - 2] = delim[1];
+
+    t0 = rngBenchNs();
+    for(n=0; n<loops; n++)
+    {
+        rngCpy(ring, cap - 2 - (n & 7), &c);
+        s_bench_sink += c;
+    }
+    rngBenchReport(cap, "cpy_at", "tail", loops, rngBenchNs() - t0, 0);
+
+    loops /= cap / 64;
+    t0 = rngBenchNs();
+    for(n=0; n<loops; n++)
+    {
+        s_bench_sink += rngFind(ring, 0, delim[0]);
+    }
+    rngBenchReport(cap, "find", "wrapped_tail", loops, rngBenchNs() - t0, 0);
+
+    t0 = rngBenchNs();
+    for(n=0; n<loops; n++)
+    {
+        s_bench_sink += rngFindPattern(ring, 0, delim, 2);
+    }
+    rngBenchReport(cap, "find_pattern", "wrapped_tail", loops, rngBenchNs() - t0, 0);
+}
+
+/*
+ * 单线程基准：各容量下的单字节读写、批量读写(逐字节对照两段memcpy)、rngLen、rngPutForce覆盖、
+ * 随机访问和查找，
+ * 输出CSV数据行(表头见rngBenchHeader)，批量读写的count为字节数
+ */
+void rngBench(int bytes)
+{
+    int c, k;
+
+    for(k=0; k<RNG_BENCH_MAX_CHUNK; k++)
+    {
+        s_bench_src[k] = (char)k;
+    }
+
+    for(c=0; c<RNG_BENCH_NUM(s_bench_caps); c++)
+    {
+        int cap = s_bench_caps[c];
+        rngBenchByte(cap, bytes);
+        for(k=0; k<RNG_BENCH_NUM(s_bench_chunks); k++)
+        {
+            if(s_bench_chunks[k] >= cap)
+            {
+                continue;
+            }
+            rngBenchBulk(cap, s_bench_chunks[k], bytes, 0);
+            rngBenchBulk(cap, s_bench_chunks[k], bytes, 1);
+        }
+        rngBenchLen(cap, bytes);
+        rngBenchPutForce(cap, bytes);
+        rngBenchFind(cap, bytes);
+    }
+}
+
+/*
+ * SPSC压力测试的参数与结果，写端写入递增序列，读端逐字节校验
+ */
+typedef struct
+{
+    T_SpscRing ring;
+    int bytes;
+    int chunk;
+    long errors;
+}T_SpscBench;
+
+static void *rngSpscProducer(void *arg)
+{
+    T_SpscBench *b = (T_SpscBench *)arg;
+    char buf[RNG_BENCH_MAX_CHUNK];
+    unsigned char seq = 0;
+    int sent = 0;
+    while(sent < b->bytes)
+    {
+        int n = b->bytes - sent;
+        int i, w;
+        if(n > b->chunk)
+        {
+            n = b->chunk;
+        }
+        for(i=0; i<n; i++)
+        {
+            buf[i] = (char)(unsigned char)(seq + i);
+        }
+        if(b->chunk == 1)
+        {
+            w = rngSpscPut(&b->ring, buf[0]) ? 1 : 0;
+        }
+        else
+        {
+            w = rngSpscBufPut(&b->ring, buf, n);
+        }
+        if(w == 0)
+        {
+            rngBenchPause(); /*对端未就绪时让出CPU，单核主机上读端才有机会运行*/
+        }
+        seq = (unsigned char)(seq + w);
+        sent += w;
+    }
+    return NULL;
+}
+
+static void *rngSpscConsumer(void *arg)
+{
+    T_SpscBench *b = (T_SpscBench *)arg;
+    char buf[RNG_BENCH_MAX_CHUNK];
+    unsigned char seq = 0;
+    int got = 0;
+    while(got < b->bytes)
+    {
+        int i, n;
+        if(b->chunk == 1)
+        {
+            n = rngSpscGet(&b->ring, buf) ? 1 : 0;
+        }
+        else
+        {
+            n = rngSpscBufGet(&b->ring, buf, b->chunk);
+        }
+        for(i=0; i<n; i++)
+        {
+            if((unsigned char)buf[i] != seq++)
+            {
+                b->errors++;
+            }
+        }
+        if(n == 0)
+        {
+            rngBenchPause();
+        }
+        got += n;
+    }
+    return NULL;
+}
+
+/*
+ * 写端和读端各一个线程，在各容量、各块大小下搬运bytes个字节并校验顺序，
+ * 输出与rngBench相同格式的CSV，errors为读端校验出错的字节数
+ */
+int rngSpscBench(int bytes)
+{
+    static T_SpscBench b;
+    long errors = 0;
+    int c, k;
+
+    for(c=0; c<RNG_BENCH_NUM(s_bench_caps); c++)
+    {
+        for(k=0; k<RNG_BENCH_NUM(s_bench_chunks); k++)
+        {
+            char pattern[24];
+            pthread_t prod, cons;
+            unsigned long long t0;
+            if(s_bench_chunks[k] >= s_bench_caps[c])
+            {
+                continue;
+            }
+            rngSpscInit(&b.ring, s_bench_buf, s_bench_caps[c]);
+            b.bytes = bytes;
+            b.chunk = s_bench_chunks[k];
+            b.errors = 0;
+            t0 = rngBenchNs();
+            pthread_create(&cons, NULL, rngSpscConsumer, &b);
+            pthread_create(&prod, NULL, rngSpscProducer, &b);
+            pthread_join(prod, NULL);
+            pthread_join(cons, NULL);
+            snprintf(pattern, sizeof(pattern), "chunk%d", s_bench_chunks[k]);
+            rngBenchReport(s_bench_caps[c], "spsc", pattern, bytes, rngBenchNs() - t0, b.errors);
+            errors += b.errors;
+        }
+    }
+    return (errors == 0) ? 0 : -1;
+}
+
+#if defined(RNG_BENCH_MAIN)
+int main(void)
+{
+    rngBenchHeader();
+    rngBench(16 * 1024 * 1024);
+    return (rngSpscBench(4 * 1024 * 1024) == 0) ? 0 : 1;
+}
+#endif
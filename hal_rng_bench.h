@@ -0,0 +1,13 @@
+#ifndef __LIB_RNG_BENCH_H_
+#define __LIB_RNG_BENCH_H_
+
+/*
+ * 主机端hal_rng基准测试，输出CSV(capacity,op,pattern,count,ps_per_op,errors)，
+ * 可保存结果与历史版本对比。编译示例
+ *     gcc -O2 -pthread -DRNG_BENCH_MAIN hal_rng.c hal_rng_bench.c
+ */
+void rngBenchHeader(void);		/*CSV表头，只输出一次*/
+void rngBench(int bytes);
+int rngSpscBench(int bytes);	/*多线程压力测试，返回0:数据全部正确*/
+
+#endif /*__LIB_RNG_BENCH_H_*/
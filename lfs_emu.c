@@ -0,0 +1,333 @@
+
+/*
+*********************************************************************************************************
+*
+*   模块名称 : littlefs块设备模拟模块
+*   文件名称 : lfs_emu.c
+*   版    本 : V1.0
+*   说    明 : 在主机(Linux)上用RAM/镜像文件模拟内外部Flash，保持NOR语义并统计读/写/擦次数，
+*              用于脱离硬件对日志和参数存储做基准测试和回归测试；可选时序模型用虚拟时钟预测片上耗时
+*   修改记录 :
+*       版本号  	日期        作者     	说明
+*       V1.0    2026-10-18 agent     	实现基本功能
+*
+*********************************************************************************************************
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "lfs_emu.h"
+
+/*STM32F1数据手册：半字编程典型52.5us/最大70us，页擦除典型20ms/最大40ms*/
+const lfs_emu_timing_t lfs_emu_timing_stm32f1 =
+{
+	.name = "stm32f1",
+	.read_cmd_ns = 0,
+	.read_ns_per_byte = 28,
+	.prog_unit = 2,
+	.prog_ns_per_byte = 0,
+	.prog_unit_typ_us = 53,
+	.prog_unit_max_us = 70,
+	.erase_typ_us = 20000,
+	.erase_max_us = 40000,
+};
+
+/*GD25Q80数据手册：页编程典型0.7ms/最大2.4ms，扇区擦除典型45ms/最大300ms，SPI按18MHz计*/
+const lfs_emu_timing_t lfs_emu_timing_gd25q80 =
+{
+	.name = "gd25q80",
+	.read_cmd_ns = 2000,
+	.read_ns_per_byte = 450,
+	.prog_unit = 256,
+	.prog_ns_per_byte = 450,
+	.prog_unit_typ_us = 700,
+	.prog_unit_max_us = 2400,
+	.erase_typ_us = 45000,
+	.erase_max_us = 300000,
+};
+
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_emu_init
+* 功能说明: 初始化模拟设备，存在镜像文件时加载镜像，否则整片置为擦除状态
+* 形   参: emu         - 模拟设备实例
+*		  mem         - 存储区，大小至少为block_size*block_count
+*		  block_size  - 块大小
+*		  block_count - 块数量
+*		  strict      - 1:写未擦除区域返回错误，0:按位与
+*		  image_path  - 镜像文件路径，可为NULL
+* 返 回 值: 0成功，-1参数错误或镜像文件长度不足(此时整片为擦除状态，不再写回镜像)
+***************************************************************************************
+*/
+int lfs_emu_init(lfs_emu_t *emu, uint8_t *mem, uint32_t block_size, uint32_t block_count,
+                 uint8_t strict, const char *image_path)
+{
+    if (emu == NULL || mem == NULL || block_size == 0 || block_count == 0)
+	{
+        return -1;
+    }
+
+    emu->mem = mem;
+    emu->block_size = block_size;
+    emu->block_count = block_count;
+    emu->strict = strict;
+    emu->image_path = image_path;
+    memset(emu->mem, LFS_EMU_ERASED_BYTE, block_size * block_count);
+    lfs_emu_reset_stats(emu);
+    lfs_emu_set_timing(emu, NULL);
+
+    if (image_path != NULL)
+	{
+        FILE *fp = fopen(image_path, "rb");
+        if (fp != NULL)
+		{
+            size_t got = fread(emu->mem, 1, block_size * block_count, fp);
+            fclose(fp);
+            if (got != (size_t)block_size * block_count)
+			{
+                /*镜像被截断，不使用部分内容，也不在sync时覆盖原文件*/
+                memset(emu->mem, LFS_EMU_ERASED_BYTE, block_size * block_count);
+                emu->image_path = NULL;
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_emu_reset_stats
+* 功能说明: 清零访问统计
+* 形   参: emu - 模拟设备实例
+* 返 回 值: 无
+***************************************************************************************
+*/
+void lfs_emu_reset_stats(lfs_emu_t *emu)
+{
+    memset(&emu->stats, 0, sizeof(emu->stats));
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_emu_set_timing
+* 功能说明: 设置时序模型并清零虚拟时钟
+* 形   参: emu    - 模拟设备实例
+*		  timing - 时序模型，NULL表示不计时
+* 返 回 值: 无
+***************************************************************************************
+*/
+void lfs_emu_set_timing(lfs_emu_t *emu, const lfs_emu_timing_t *timing)
+{
+    emu->timing = timing;
+    emu->clock_ns = 0;
+    emu->clock_max_ns = 0;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_emu_span_begin
+* 功能说明: 开始统计一次上层操作的预测耗时
+* 形   参: emu  - 模拟设备实例
+*		  span - 耗时记录
+* 返 回 值: 无
+***************************************************************************************
+*/
+void lfs_emu_span_begin(const lfs_emu_t *emu, lfs_emu_span_t *span)
+{
+    span->start_ns = emu->clock_ns;
+    span->start_max_ns = emu->clock_max_ns;
+    span->start_erases = emu->stats.erases;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_emu_span_end
+* 功能说明: 结束统计，计算典型/最坏耗时以及期间的擦除次数
+* 形   参: emu  - 模拟设备实例
+*		  span - 耗时记录
+* 返 回 值: 无
+***************************************************************************************
+*/
+void lfs_emu_span_end(const lfs_emu_t *emu, lfs_emu_span_t *span)
+{
+    span->typ_us = (uint32_t)((emu->clock_ns - span->start_ns) / 1000U);
+    span->max_us = (uint32_t)((emu->clock_max_ns - span->start_max_ns) / 1000U);
+    span->erases = emu->stats.erases - span->start_erases;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_emu_tick
+* 功能说明: 推进虚拟时钟
+* 形   参: emu - 模拟设备实例；typ_ns - 典型耗时；max_ns - 最坏耗时
+* 返 回 值: 无
+***************************************************************************************
+*/
+static void lfs_emu_tick(lfs_emu_t *emu, uint64_t typ_ns, uint64_t max_ns)
+{
+    emu->clock_ns += typ_ns;
+    emu->clock_max_ns += max_ns;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_emu_check
+* 功能说明: 检查访问范围是否越界
+* 形   参: emu - 模拟设备实例；block - 块编号；off - 块内偏移；size - 长度
+* 返 回 值: 0合法，LFS_ERR_INVAL越界
+***************************************************************************************
+*/
+static int lfs_emu_check(const lfs_emu_t *emu, lfs_block_t block, lfs_off_t off, lfs_size_t size)
+{
+    if (block >= emu->block_count || off + size > emu->block_size)
+	{
+        return LFS_ERR_INVAL;
+    }
+    return LFS_ERR_OK;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_emu_read
+* 功能说明: lfs读接口
+* 形   参: c		 - 文件系统配置，context指向lfs_emu_t
+*		  block  - 块编号
+*		  off 	 - 块内偏移地址
+*		  buffer - 暂存待读取的数据
+*		  size 	 - 待读取数据的大小
+* 返 回 值: lfs的状态码
+***************************************************************************************
+*/
+int lfs_emu_read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size)
+{
+    lfs_emu_t *emu = (lfs_emu_t *)c->context;
+    int err = lfs_emu_check(emu, block, off, size);
+    if (err)
+	{
+        return err;
+    }
+
+    memcpy(buffer, &emu->mem[block * emu->block_size + off], size);
+    emu->stats.reads++;
+    emu->stats.read_bytes += size;
+    if (emu->timing)
+	{
+        uint64_t ns = emu->timing->read_cmd_ns + (uint64_t)size * emu->timing->read_ns_per_byte;
+        lfs_emu_tick(emu, ns, ns);
+    }
+    return LFS_ERR_OK;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_emu_prog
+* 功能说明: lfs编程接口，只能把1写成0
+* 形   参: c		 - 文件系统配置，context指向lfs_emu_t
+*		  block  - 块编号
+*		  off 	 - 块内偏移地址
+*		  buffer - 待写入的数据
+*		  size 	 - 待写入数据的大小
+* 返 回 值: lfs的状态码
+***************************************************************************************
+*/
+int lfs_emu_prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size)
+{
+    lfs_emu_t *emu = (lfs_emu_t *)c->context;
+    const uint8_t *src = (const uint8_t *)buffer;
+    int err = lfs_emu_check(emu, block, off, size);
+    if (err)
+	{
+        return err;
+    }
+
+    uint8_t *dst = &emu->mem[block * emu->block_size + off];
+    uint8_t violated = 0;
+    for (lfs_size_t i = 0; i < size; i++)
+	{
+        if ((uint8_t)(~dst[i] & src[i]) != 0)
+		{
+            violated = 1;
+        }
+    }
+
+    emu->stats.progs++;
+    if (emu->timing)
+	{
+        uint32_t units = (size + emu->timing->prog_unit - 1) / emu->timing->prog_unit;
+        uint64_t xfer = (uint64_t)size * emu->timing->prog_ns_per_byte;
+        lfs_emu_tick(emu, xfer + (uint64_t)units * emu->timing->prog_unit_typ_us * 1000U,
+                          xfer + (uint64_t)units * emu->timing->prog_unit_max_us * 1000U);
+    }
+    if (violated)
+	{
+        emu->stats.prog_violations++;
+        if (emu->strict)
+		{
+            return LFS_ERR_IO;
+        }
+    }
+
+    for (lfs_size_t i = 0; i < size; i++)
+	{
+        dst[i] &= src[i];
+    }
+    emu->stats.prog_bytes += size;
+    return LFS_ERR_OK;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_emu_erase
+* 功能说明: lfs擦除接口，整块置为0xFF
+* 形   参: c 	 - 文件系统配置，context指向lfs_emu_t
+*		  block  - 块编号
+* 返 回 值: lfs的状态码
+***************************************************************************************
+*/
+int lfs_emu_erase(const struct lfs_config *c, lfs_block_t block)
+{
+    lfs_emu_t *emu = (lfs_emu_t *)c->context;
+    int err = lfs_emu_check(emu, block, 0, emu->block_size);
+    if (err)
+	{
+        return err;
+    }
+
+    memset(&emu->mem[block * emu->block_size], LFS_EMU_ERASED_BYTE, emu->block_size);
+    emu->stats.erases++;
+    if (emu->timing)
+	{
+        lfs_emu_tick(emu, (uint64_t)emu->timing->erase_typ_us * 1000U,
+                          (uint64_t)emu->timing->erase_max_us * 1000U);
+    }
+    return LFS_ERR_OK;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_emu_sync
+* 功能说明: lfs同步接口，配置了镜像文件时把存储区写回文件
+* 形   参: c - 文件系统配置，context指向lfs_emu_t
+* 返 回 值: lfs的状态码
+***************************************************************************************
+*/
+int lfs_emu_sync(const struct lfs_config *c)
+{
+    lfs_emu_t *emu = (lfs_emu_t *)c->context;
+    if (emu->image_path == NULL)
+	{
+        return LFS_ERR_OK;
+    }
+
+    FILE *fp = fopen(emu->image_path, "wb");
+    if (fp == NULL)
+	{
+        return LFS_ERR_IO;
+    }
+    size_t total = (size_t)emu->block_size * emu->block_count;
+    size_t n = fwrite(emu->mem, 1, total, fp);
+    fclose(fp);
+    return (n == total) ? LFS_ERR_OK : LFS_ERR_IO;
+}
@@ -0,0 +1,71 @@
+#ifndef __LFS_EMU
+#define __LFS_EMU
+
+#include <stdint.h>
+#include "lfs.h"
+
+/*-------------------- 主机端块设备模拟 --------------------*/
+/*NOR语义：编程只能把1写成0，擦除后整块为0xFF*/
+#define LFS_EMU_ERASED_BYTE		0xFF
+
+/*访问统计*/
+typedef struct {
+    uint32_t reads;            /*读次数*/
+    uint32_t progs;            /*编程次数*/
+    uint32_t erases;           /*擦除次数*/
+    uint32_t read_bytes;       /*读字节数*/
+    uint32_t prog_bytes;       /*编程字节数*/
+    uint32_t prog_violations;  /*试图把0写回1的编程次数*/
+} lfs_emu_stats_t;
+
+/*时序模型，典型值和最大值分别累计，用于预测片上耗时*/
+typedef struct {
+    const char *name;
+    uint32_t read_cmd_ns;         /*每次读的固定开销*/
+    uint32_t read_ns_per_byte;    /*每字节读耗时*/
+    uint32_t prog_unit;           /*编程单位(字节)，不足一个单位按一个单位计*/
+    uint32_t prog_ns_per_byte;    /*编程时每字节传输耗时*/
+    uint32_t prog_unit_typ_us;    /*每个编程单位的典型耗时*/
+    uint32_t prog_unit_max_us;    /*每个编程单位的最大耗时*/
+    uint32_t erase_typ_us;        /*块擦除典型耗时*/
+    uint32_t erase_max_us;        /*块擦除最大耗时*/
+} lfs_emu_timing_t;
+
+extern const lfs_emu_timing_t lfs_emu_timing_stm32f1;  /*STM32F1内部Flash：半字编程、2K页擦除*/
+extern const lfs_emu_timing_t lfs_emu_timing_gd25q80;  /*GD25Q80：256B页编程、4K扇区擦除*/
+
+/*模拟设备实例，通过lfs_config.context绑定*/
+typedef struct {
+    uint8_t        *mem;          /*存储区，大小为block_size*block_count*/
+    uint32_t        block_size;
+    uint32_t        block_count;
+    uint8_t         strict;       /*1:写未擦除区域返回错误(STM32F1内部Flash)，0:按位与(GD25Q80)*/
+    const char     *image_path;   /*非NULL时从文件加载镜像，sync时写回*/
+    lfs_emu_stats_t stats;
+    const lfs_emu_timing_t *timing; /*时序模型，NULL表示不计时*/
+    uint64_t        clock_ns;     /*虚拟时钟(典型值)*/
+    uint64_t        clock_max_ns; /*虚拟时钟(最坏值)*/
+} lfs_emu_t;
+
+/*一次操作的预测耗时*/
+typedef struct {
+    uint64_t start_ns;
+    uint64_t start_max_ns;
+    uint32_t start_erases;
+    uint32_t typ_us;              /*典型耗时*/
+    uint32_t max_us;              /*最坏耗时*/
+    uint32_t erases;              /*期间发生的擦除次数，非0即为耗时尖峰*/
+} lfs_emu_span_t;
+
+int  lfs_emu_init(lfs_emu_t *emu, uint8_t *mem, uint32_t block_size, uint32_t block_count,
+                  uint8_t strict, const char *image_path);
+void lfs_emu_reset_stats(lfs_emu_t *emu);
+void lfs_emu_set_timing(lfs_emu_t *emu, const lfs_emu_timing_t *timing);
+void lfs_emu_span_begin(const lfs_emu_t *emu, lfs_emu_span_t *span);
+void lfs_emu_span_end(const lfs_emu_t *emu, lfs_emu_span_t *span);
+int  lfs_emu_read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size);
+int  lfs_emu_prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size);
+int  lfs_emu_erase(const struct lfs_config *c, lfs_block_t block);
+int  lfs_emu_sync(const struct lfs_config *c);
+
+#endif
@@ -4,22 +4,29 @@
 *
 *   模块名称 : littlefs接口模块
 *   文件名称 : lfs_port.c
-*   版    本 : V1.0
+*   版    本 : V1.1
 *   说    明 : 利用littlefs完成日志和关键参数的存储，支持掉电保护、磨损均衡、写满自动回滚
 *   修改记录 :
 *       版本号  	日期        作者     	说明
 *       V1.0    2025-08-25 汤金铖    	实现基本功能--内部存储参数，外部存储日志
+*       V1.1    2026-10-18 agent     	日志文件常开并在RAM中暂存；可选带CRC的记录帧；按通道拆分轮转上下文，
+*                                    	挂载时从日志文件恢复轮转状态；游标/迭代器分块读取日志；主机端模拟设备
 *
 *********************************************************************************************************
 */
 
 #include "lfs.h"
+#include "lfs_port.h"
+#if !LFS_PORT_USE_EMU
 #include "hal_QDflash.h"
 #include "stm32f10x_flash.h"
+#else
+#include <time.h>
+#endif
 #include <string.h>
+#include "crc16.h"
 #include "debug.h"
 #include "g.h"
-#include "lfs_port.h"
  
 
 /* 静态内存使用方式必须设定这四个缓存*/
@@ -38,7 +45,151 @@ __align(4) static uint8_t file_outer_buffer[64];
 lfs_t lfs_inter_flash;
 lfs_t lfs_outer_flash;
 
-rotation_state_t g_rotation = {0, 0, 0, 0, 0};  
+/*常驻写入：日志文件保持打开，记录先进入RAM暂存区，写满/超时/显式刷新/轮转时才写入Flash*/
+typedef struct {
+    lfs_file_t  file;
+    uint8_t    *file_buffer;   /*文件缓存，大小需与cache_size一致*/ 
+    uint8_t    *stage;         /*RAM暂存区*/ 
+    uint16_t    stage_size;    /*暂存区大小*/ 
+    uint16_t    stage_len;     /*暂存区已有数据长度*/ 
+    uint8_t     is_open;       /*文件是否处于打开状态*/ 
+    uint8_t     dirty;         /*文件中是否有未sync的数据*/ 
+    uint32_t    last_flush_ms; /*上次刷新时间*/ 
+    uint32_t    seq;           /*当前文件的序号，作为文件属性随数据一起提交*/ 
+    struct lfs_attr seq_attr;
+    struct lfs_file_config fcfg; /*文件打开期间lfs会引用该配置，不能放在栈上*/ 
+} rotation_writer_t;
+
+/*日志通道的轮转上下文*/
+typedef struct {
+    lfs_t      *lfs;           /*所在文件系统*/ 
+    const char *prefix;        /*文件前缀*/ 
+    uint16_t    max_files;     /*轮转文件个数，不超过ROTATION_FILES_LIMIT*/ 
+    uint32_t    max_file_size; /*单个文件的大小*/ 
+    rotation_state_t  state;
+    rotation_writer_t writer;
+} rotation_ctx_t;
+
+__align(4) static uint8_t writer_inter_file_buffer[16];
+__align(4) static uint8_t writer_outer_file_buffer[64];
+__align(4) static uint8_t writer_inter_stage[ROTATION_STAGE_SIZE];
+__align(4) static uint8_t writer_outer_stage[ROTATION_STAGE_SIZE];
+#if LOG_EXTRA_CHANNELS
+__align(4) static uint8_t writer_fault_file_buffer[64];
+__align(4) static uint8_t writer_telemetry_file_buffer[64];
+__align(4) static uint8_t writer_debug_file_buffer[64];
+__align(4) static uint8_t writer_fault_stage[LOG_CH_STAGE_SIZE];
+__align(4) static uint8_t writer_telemetry_stage[LOG_CH_STAGE_SIZE];
+__align(4) static uint8_t writer_debug_stage[LOG_CH_STAGE_SIZE];
+#endif
+
+static rotation_ctx_t g_rot_ctx[LOG_CHANNEL_NUM] = 
+{
+	[LOG_CH_INTER] = 
+	{
+		.lfs = &lfs_inter_flash,
+		.prefix = FILE_PREFIX,
+		.max_files = MAX_ROTATION_FILES,
+		.max_file_size = MAX_FILE_SIZE,
+		.writer = {.file_buffer = writer_inter_file_buffer, .stage = writer_inter_stage, .stage_size = ROTATION_STAGE_SIZE},
+	},
+	[LOG_CH_OUTER] = 
+	{
+		.lfs = &lfs_outer_flash,
+		.prefix = FILE_PREFIX,
+		.max_files = MAX_ROTATION_FILES,
+		.max_file_size = MAX_FILE_SIZE,
+		.writer = {.file_buffer = writer_outer_file_buffer, .stage = writer_outer_stage, .stage_size = ROTATION_STAGE_SIZE},
+	},
+#if LOG_EXTRA_CHANNELS
+	[LOG_CH_FAULT] = 
+	{
+		.lfs = &lfs_outer_flash,
+		.prefix = "flt",
+		.max_files = LOG_FAULT_FILES,
+		.max_file_size = LOG_FAULT_FILE_SIZE,
+		.writer = {.file_buffer = writer_fault_file_buffer, .stage = writer_fault_stage, .stage_size = LOG_CH_STAGE_SIZE},
+	},
+	[LOG_CH_TELEMETRY] = 
+	{
+		.lfs = &lfs_outer_flash,
+		.prefix = "tlm",
+		.max_files = LOG_TELEMETRY_FILES,
+		.max_file_size = LOG_TELEMETRY_FILE_SIZE,
+		.writer = {.file_buffer = writer_telemetry_file_buffer, .stage = writer_telemetry_stage, .stage_size = LOG_CH_STAGE_SIZE},
+	},
+	[LOG_CH_DEBUG] = 
+	{
+		.lfs = &lfs_outer_flash,
+		.prefix = "dbg",
+		.max_files = LOG_DEBUG_FILES,
+		.max_file_size = LOG_DEBUG_FILE_SIZE,
+		.writer = {.file_buffer = writer_debug_file_buffer, .stage = writer_debug_stage, .stage_size = LOG_CH_STAGE_SIZE},
+	},
+#endif
+};
+
+/*
+***************************************************************************************
+* 函 数 名: rotation_get_ctx
+* 功能说明: 获取日志通道的轮转上下文
+* 形   参: ch - 日志通道LOG_CH_xxx
+* 返 回 值: 轮转上下文，无效通道返回NULL
+***************************************************************************************
+*/
+static rotation_ctx_t *rotation_get_ctx(uint8_t ch)
+{
+	return (ch < LOG_CHANNEL_NUM) ? &g_rot_ctx[ch] : NULL;
+}
+
+#if LFS_PORT_USE_EMU
+/*模拟后端：存储区放在RAM中，几何结构与inter_cfg/outer_cfg一致*/
+static uint8_t inter_emu_mem[BLOCK_NUM * 2048];
+static uint8_t outer_emu_mem[OUTER_BLOCK_NUM * 4096];
+static lfs_emu_t inter_emu;
+static lfs_emu_t outer_emu;
+static lfs_latency_t g_latency[LFS_LAT_NUM];
+static const char *const g_latency_name[LFS_LAT_NUM] = {"rotation_write", "param_set", "mount"};
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_port_latency_record
+* 功能说明: 记录一次操作的预测耗时，期间发生擦除时打印尖峰
+* 形   参: op   - 操作类型
+*		  span - 本次操作的耗时记录
+* 返 回 值: 无
+***************************************************************************************
+*/
+static void lfs_port_latency_record(lfs_lat_op_t op, const lfs_emu_span_t *span)
+{
+    lfs_latency_t *lat = &g_latency[op];
+    lat->count++;
+    lat->last_us = span->typ_us;
+    lat->total_us += span->typ_us;
+    if (span->typ_us > lat->max_us) 
+	{
+        lat->max_us = span->typ_us;
+    }
+    if (span->max_us > lat->worst_us) 
+	{
+        lat->worst_us = span->max_us;
+    }
+    if (span->erases) 
+	{
+        lat->spikes++;
+        always_Print(0, ("%s: predicted %uus (worst %uus), %u erase(s)\r\n", 
+                       g_latency_name[op], span->typ_us, span->max_us, span->erases));
+    }
+}
+
+/*对lfs操作计时，lfs需为已挂载实例*/
+#define LFS_LAT_BEGIN(lfs)		lfs_emu_span_t lat_span; \
+								lfs_emu_span_begin((lfs_emu_t *)(lfs)->cfg->context, &lat_span)
+#define LFS_LAT_END(lfs, op)	do { lfs_emu_span_end((lfs_emu_t *)(lfs)->cfg->context, &lat_span); \
+								     lfs_port_latency_record((op), &lat_span); } while (0)
+#else
+#define LFS_LAT_BEGIN(lfs)
+#define LFS_LAT_END(lfs, op)
 
 /*
 ***************************************************************************************
@@ -219,14 +370,23 @@ static int lfs_deskio_sync(const struct lfs_config *c)
 {
 	return LFS_ERR_OK;
 }
+#endif
 
 /*内外部flash配置，相当于两个文件系统的属性设置*/
 const struct lfs_config inter_cfg =
 {
+#if LFS_PORT_USE_EMU
+	.context = &inter_emu,
+	.read  = lfs_emu_read,
+	.prog  = lfs_emu_prog,
+	.erase = lfs_emu_erase,
+	.sync  = lfs_emu_sync,
+#else
 	.read  = lfs_inter_read,
 	.prog  = lfs_inter_prog,
 	.erase = lfs_inter_erase,
 	.sync  = lfs_deskio_sync,
+#endif
 
 	.read_size = 16,
 	.prog_size = 16,
@@ -244,10 +404,18 @@ const struct lfs_config inter_cfg =
 
 const struct lfs_config outer_cfg =
 {
+#if LFS_PORT_USE_EMU
+	.context = &outer_emu,
+	.read  = lfs_emu_read,
+	.prog  = lfs_emu_prog,
+	.erase = lfs_emu_erase,
+	.sync  = lfs_emu_sync,
+#else
 	.read  = lfs_outer_read,
 	.prog  = lfs_outer_prog,
 	.erase = lfs_outer_erase,
 	.sync  = lfs_deskio_sync,
+#endif
 
 	.read_size = 64,
 	.prog_size = 64,
@@ -286,15 +454,44 @@ lfs_size_t get_file_size(lfs_t *lfs,const char *filename)
 
 
 
-int rotation_write(lfs_t *lfs, const void *data, uint32_t size);
+static int rotation_write(rotation_ctx_t *ctx, const void *data, uint32_t size);
+static int rotation_write_record(rotation_ctx_t *ctx, uint8_t rec_type, uint32_t ts_ms, const void *data, uint32_t size);
 int lfs_store_log_internal(const void *log_message, int message_len)
 {
-	return rotation_write(&lfs_inter_flash, log_message, message_len);
+	return rotation_write(&g_rot_ctx[LOG_CH_INTER], log_message, message_len);
 }
 
 int lfs_store_log_outernal(const void *log_message, int message_len)
 {
-	return rotation_write(&lfs_outer_flash, log_message, message_len);
+	return rotation_write(&g_rot_ctx[LOG_CH_OUTER], log_message, message_len);
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_store_record
+* 功能说明: 写入一条指定类型的日志记录，LOG_RECORD_FRAMED为0时按原样写入
+* 形   参: type 	- 日志通道LOG_CH_xxx
+*		  rec_type - 记录类型 LOG_REC_*
+*		  ts_ms 	- 记录产生时的时间戳
+*		  data 	- 负载
+*		  len 	- 负载长度
+* 返 回 值: 写入文件的字节数，-1失败
+***************************************************************************************
+*/
+int lfs_store_record(uint8_t type, uint8_t rec_type, uint32_t ts_ms, const void *data, int len)
+{
+	rotation_ctx_t *ctx = rotation_get_ctx(type);
+	if (ctx == NULL || len <= 0)
+	{
+		return -1;
+	}
+#if LOG_RECORD_FRAMED
+	return rotation_write_record(ctx, rec_type, ts_ms, data, len);
+#else
+	(void)rec_type;
+	(void)ts_ms;
+	return rotation_write(ctx, data, len);
+#endif
 }
 
 /*
@@ -361,8 +558,10 @@ int param_set(param_id_enum_t param_id, const void* value)
             return -1;
     }
     
+    LFS_LAT_BEGIN(&lfs_inter_flash);
     int result = lfs_setattr(&lfs_inter_flash, PARAM_FILENAME, param_id, 
                             &entry->value, entry->size);
+    LFS_LAT_END(&lfs_inter_flash, LFS_LAT_PARAM_SET);
     
     always_Print(0, ("param_set: param_id=%d, type=%d, result=%d\r\n", 
                     param_id, entry->type, result));
@@ -455,9 +654,9 @@ int param_file_init(lfs_t *lfs)
 * 返 回 值: lfs的状态码
 ***************************************************************************************
 */
-static void generate_filename(uint16_t file_id, char *filename)
+static void generate_filename(const rotation_ctx_t *ctx, uint16_t file_id, char *filename)
 {
-    snprintf(filename,FILENAME_BUFFER_SIZE,"%s%03d%s",FILE_PREFIX,file_id,FILE_EXTENSION);
+    snprintf(filename,FILENAME_BUFFER_SIZE,"%s%03d%s",ctx->prefix,file_id,FILE_EXTENSION);
 }
 
 
@@ -465,24 +664,24 @@ static void generate_filename(uint16_t file_id, char *filename)
 ***************************************************************************************
 * 函 数 名: delete_oldest_file
 * 功能说明: 删除最旧的文件
-* 形   参: lfs - 文件系统实例
+* 形   参: ctx - 轮转上下文
 * 返 回 值: 0成功，-1失败
 ***************************************************************************************
 */
-static int delete_oldest_file(lfs_t *lfs)
+static int delete_oldest_file(rotation_ctx_t *ctx)
 {
     char filename[FILENAME_BUFFER_SIZE];
-    generate_filename(g_rotation.oldest_file_id, filename);
+    generate_filename(ctx, ctx->state.oldest_file_id, filename);
     
-    int result = lfs_remove(lfs, filename);
-	lfs_fs_gc(lfs);
-    if (result == 0) 
+    int result = lfs_remove(ctx->lfs, filename);
+	lfs_fs_gc(ctx->lfs);
+    if (result == 0 || result == LFS_ERR_NOENT) 
 	{
         always_Print(0, ("Deleted oldest file: %s\r\n", filename));
         
         /*更新最旧文件ID,循环递增*/ 
-        g_rotation.oldest_file_id = (g_rotation.oldest_file_id + 1) % MAX_ROTATION_FILES;
-        g_rotation.active_file_count--;
+        ctx->state.oldest_file_id = (ctx->state.oldest_file_id + 1) % ctx->max_files;
+        ctx->state.active_file_count--;
         return 0;
     } 
 	else 
@@ -497,20 +696,20 @@ static int delete_oldest_file(lfs_t *lfs)
 ***************************************************************************************
 * 函 数 名: switch_to_next_file
 * 功能说明: 切换到下一个文件
-* 形   参: lfs - 文件系统实例
+* 形   参: ctx - 轮转上下文
 * 返 回 值: 0成功，-1失败
 ***************************************************************************************
 */
-static int switch_to_next_file(lfs_t *lfs)
+static int switch_to_next_file(rotation_ctx_t *ctx)
 {
     always_Print(0, ("switch_to_next_file: BEFORE - active_count=%d, newest_id=%d, oldest_id=%d\r\n", 
-                   g_rotation.active_file_count, g_rotation.newest_file_id, g_rotation.oldest_file_id));
+                   ctx->state.active_file_count, ctx->state.newest_file_id, ctx->state.oldest_file_id));
     
     /*如果已经达到最大文件数，删除最旧的文件*/ 
-    if (g_rotation.active_file_count >= MAX_ROTATION_FILES) 
+    if (ctx->state.active_file_count >= ctx->max_files) 
 	{
         always_Print(0, ("Max files reached, deleting oldest file\r\n"));
-        if (delete_oldest_file(lfs) < 0) 
+        if (delete_oldest_file(ctx) < 0) 
 		{
 			always_Print(0, ("Failed to delete file"));
             return -1;
@@ -518,128 +717,477 @@ static int switch_to_next_file(lfs_t *lfs)
     }
     
     /*切换到下一个文件*/ 
-    g_rotation.newest_file_id = (g_rotation.newest_file_id + 1) % MAX_ROTATION_FILES;
-    g_rotation.current_file_offset = 0;
+    ctx->state.newest_file_id = (ctx->state.newest_file_id + 1) % ctx->max_files;
+    ctx->state.newest_seq++;
+    ctx->state.current_file_offset = 0;
     
-    g_rotation.active_file_count++;
+    ctx->state.active_file_count++;
 
-	lfs_setattr(lfs,ROTATION_INFO_FILE_NAME,ROTATION_ACTIVE_FILE_ID,
-				&g_rotation.active_file_count,sizeof(g_rotation.active_file_count));
-	lfs_setattr(lfs,ROTATION_INFO_FILE_NAME,ROTATION_NEWEST_FILE_ID,
-				&g_rotation.newest_file_id,sizeof(g_rotation.newest_file_id));
-	lfs_setattr(lfs,ROTATION_INFO_FILE_NAME,ROTATION_OLDEST_FILE_ID,
-				&g_rotation.oldest_file_id,sizeof(g_rotation.oldest_file_id));
+    /*新文件的序号在第一次sync时作为文件属性写入，这里不再单独提交轮转信息*/ 
     char filename[FILENAME_BUFFER_SIZE];
-    generate_filename(g_rotation.newest_file_id, filename);
+    generate_filename(ctx, ctx->state.newest_file_id, filename);
     always_Print(0, ("Switched to new file: %s - active_count=%d, newest_id=%d, oldest_id=%d\r\n", 
-                   filename, g_rotation.active_file_count, g_rotation.newest_file_id, g_rotation.oldest_file_id));
+                   filename, ctx->state.active_file_count, ctx->state.newest_file_id, ctx->state.oldest_file_id));
+    
+    return 0;
+}
+
+
+
+/*
+***************************************************************************************
+* 函 数 名: rotation_migrate_legacy
+* 功能说明: 旧版本的日志文件没有序号属性，按rotation.txt中记录的新旧顺序补写序号，
+*          补写的序号排在已有序号之前，完成后删除rotation.txt
+* 形   参: ctx     - 轮转上下文
+*		  present - 各文件是否存在
+*		  has_seq - 各文件是否已有序号，补写后置1
+*		  seq     - 各文件的序号
+* 返 回 值: 无
+***************************************************************************************
+*/
+static void rotation_migrate_legacy(rotation_ctx_t *ctx, const uint8_t *present, uint8_t *has_seq, uint32_t *seq)
+{
+    uint16_t oldest_id = 0;
+    uint16_t legacy_count = 0;
+    uint32_t min_seq = 0;
+    uint8_t found = 0;
+    
+    for (uint16_t id = 0; id < ctx->max_files; id++) 
+	{
+        if (has_seq[id] && (!found || seq[id] < min_seq)) 
+		{
+            min_seq = seq[id];
+            found = 1;
+        }
+        if (present[id] && !has_seq[id]) 
+		{
+            legacy_count++;
+        }
+    }
+    if (lfs_getattr(ctx->lfs, ROTATION_INFO_FILE_NAME, ROTATION_OLDEST_FILE_ID, 
+                    &oldest_id, sizeof(oldest_id)) != sizeof(oldest_id) || oldest_id >= ctx->max_files) 
+	{
+        oldest_id = 0;
+    }
+    
+    /*从最旧的文件开始依次编号，保证旧文件的序号小于新文件*/ 
+    uint32_t next = found ? (min_seq - legacy_count) : 1;
+    for (uint16_t k = 0; k < ctx->max_files; k++) 
+	{
+        uint16_t id = (oldest_id + k) % ctx->max_files;
+        if (present[id] && !has_seq[id]) 
+		{
+            char filename[FILENAME_BUFFER_SIZE];
+            generate_filename(ctx, id, filename);
+            seq[id] = next++;
+            has_seq[id] = 1;
+            lfs_setattr(ctx->lfs, filename, ROTATION_FILE_SEQ_ID, &seq[id], sizeof(seq[id]));
+        }
+    }
+    lfs_remove(ctx->lfs, ROTATION_INFO_FILE_NAME);
+    always_Print(0, ("Migrated %d legacy log files\r\n", legacy_count));
+}
+
+
+/*
+***************************************************************************************
+* 函 数 名: rotation_restore
+* 功能说明: 挂载时根据轮转文件本身恢复轮转状态：文件是否存在、文件大小和序号属性，
+*          序号最大的为最新文件，其大小即为当前写入偏移
+* 形   参: ctx - 轮转上下文
+* 返 回 值: 有效文件个数
+***************************************************************************************
+*/
+static int rotation_restore(rotation_ctx_t *ctx)
+{
+    uint8_t present[ROTATION_FILES_LIMIT] = {0};
+    uint8_t has_seq[ROTATION_FILES_LIMIT] = {0};
+    uint32_t seq[ROTATION_FILES_LIMIT] = {0};
+    lfs_size_t size[ROTATION_FILES_LIMIT] = {0};
+    uint8_t legacy = 0;
+    
+    for (uint16_t id = 0; id < ctx->max_files; id++) 
+	{
+        char filename[FILENAME_BUFFER_SIZE];
+        struct lfs_info info;
+        generate_filename(ctx, id, filename);
+        if (lfs_stat(ctx->lfs, filename, &info) < 0) 
+		{
+            continue;
+        }
+        present[id] = 1;
+        size[id] = info.size;
+        if (lfs_getattr(ctx->lfs, filename, ROTATION_FILE_SEQ_ID, &seq[id], sizeof(seq[id])) == sizeof(seq[id])) 
+		{
+            has_seq[id] = 1;
+        }
+        else 
+		{
+            legacy = 1;
+        }
+    }
+    if (legacy) 
+	{
+        rotation_migrate_legacy(ctx, present, has_seq, seq);
+    }
+    
+    memset(&ctx->state, 0, sizeof(ctx->state));
+    uint32_t oldest_seq = 0;
+    for (uint16_t id = 0; id < ctx->max_files; id++) 
+	{
+        if (!present[id]) 
+		{
+            continue;
+        }
+        if (ctx->state.active_file_count == 0 || seq[id] > ctx->state.newest_seq) 
+		{
+            ctx->state.newest_file_id = id;
+            ctx->state.newest_seq = seq[id];
+        }
+        if (ctx->state.active_file_count == 0 || seq[id] < oldest_seq) 
+		{
+            oldest_seq = seq[id];
+        }
+        ctx->state.active_file_count++;
+    }
+    if (ctx->state.active_file_count > 0) 
+	{
+        ctx->state.current_file_offset = size[ctx->state.newest_file_id];
+        /*文件ID与序号一一对应，中间缺失的文件(轮转时掉电)按空文件处理*/ 
+        uint32_t span = ctx->state.newest_seq - oldest_seq + 1;
+        ctx->state.active_file_count = (uint16_t)((span < ctx->max_files) ? span : ctx->max_files);
+        ctx->state.oldest_file_id = (uint16_t)((ctx->state.newest_file_id + ctx->max_files
+                                    - (ctx->state.active_file_count - 1)) % ctx->max_files);
+    }
+    return ctx->state.active_file_count;
+}
+
+
+/*
+***************************************************************************************
+* 函 数 名: rotation_writer_open
+* 功能说明: 以追加方式打开当前最新的轮转文件，已打开则直接返回
+* 形   参: ctx - 轮转上下文
+* 返 回 值: 0成功，负数为lfs错误码
+***************************************************************************************
+*/
+static int rotation_writer_open(rotation_ctx_t *ctx)
+{
+    rotation_writer_t *w = &ctx->writer;
+    if (w->is_open) 
+	{
+        return 0;
+    }
+    
+    char filename[FILENAME_BUFFER_SIZE];
+    generate_filename(ctx, ctx->state.newest_file_id, filename);
+    w->seq = ctx->state.newest_seq;
+    w->seq_attr.type = ROTATION_FILE_SEQ_ID;
+    w->seq_attr.buffer = &w->seq;
+    w->seq_attr.size = sizeof(w->seq);
+    w->fcfg.buffer = w->file_buffer;
+    w->fcfg.attrs = &w->seq_attr;
+    w->fcfg.attr_count = 1;
+	
+    int err = lfs_file_opencfg(ctx->lfs, &w->file, filename, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND, &w->fcfg);
+    if (err < 0) 
+	{
+        always_Print(0, ("Failed to open file: %s, error: %d\r\n", filename, err));
+        return err;
+    }
+    w->is_open = 1;
+    w->last_flush_ms = g_systick_ms;
+    return 0;
+}
+
+
+/*
+***************************************************************************************
+* 函 数 名: rotation_writer_flush
+* 功能说明: 将暂存区的数据写入文件并sync，文件大小即为写入偏移，不再另外提交
+* 形   参: ctx - 轮转上下文
+* 返 回 值: 0成功，-1失败
+***************************************************************************************
+*/
+static int rotation_writer_flush(rotation_ctx_t *ctx)
+{
+    rotation_writer_t *w = &ctx->writer;
+    w->last_flush_ms = g_systick_ms;
+    if (w->stage_len == 0 && !w->dirty) 
+	{
+        return 0;
+    }
+    if (rotation_writer_open(ctx) < 0) 
+	{
+        return -1;
+    }
+    
+    if (w->stage_len > 0) 
+	{
+        lfs_ssize_t written = lfs_file_write(ctx->lfs, &w->file, w->stage, w->stage_len);
+        if (written < 0) 
+		{
+            always_Print(0, ("Failed to write stage buffer, error: %d\r\n", (int)written));
+            return -1;
+        }
+        w->stage_len = 0;
+    }
     
+    int err = lfs_file_sync(ctx->lfs, &w->file);
+    w->dirty = 0;
+    if (err < 0) 
+	{
+        always_Print(0, ("Failed to sync log file, error: %d\r\n", err));
+        return -1;
+    }
+    always_Print(0, ("Flushed log file %d, offset now: %d\r\n", ctx->state.newest_file_id, ctx->state.current_file_offset));
     return 0;
 }
 
 
+/*
+***************************************************************************************
+* 函 数 名: rotation_writer_close
+* 功能说明: 刷新暂存区并关闭常驻文件，轮转或读取前调用
+* 形   参: ctx - 轮转上下文
+* 返 回 值: 0成功，-1失败
+***************************************************************************************
+*/
+static int rotation_writer_close(rotation_ctx_t *ctx)
+{
+    rotation_writer_t *w = &ctx->writer;
+    int ret = rotation_writer_flush(ctx);
+    if (w->is_open) 
+	{
+        lfs_file_close(ctx->lfs, &w->file);
+        w->is_open = 0;
+    }
+    return ret;
+}
+
+
+/*
+***************************************************************************************
+* 函 数 名: rotation_writer_put
+* 功能说明: 把一条记录(帧头+数据)整体放入暂存区，暂存区放不下时先刷新，超过暂存区大小的
+*          记录直接写入文件。失败时暂存区保持调用前的内容，不会留下没有数据的帧头
+* 形   参: ctx      - 轮转上下文
+*		  head     - 帧头，可为NULL
+*		  head_len - 帧头长度
+*		  data     - 数据
+*		  size     - 大小
+* 返 回 值: 0成功，-1失败
+***************************************************************************************
+*/
+static int rotation_writer_put(rotation_ctx_t *ctx, const void *head, uint32_t head_len, const void *data, uint32_t size)
+{
+    rotation_writer_t *w = &ctx->writer;
+    uint32_t total = head_len + size;
+    
+    if (w->stage_len + total > w->stage_size) 
+	{
+        if (rotation_writer_flush(ctx) < 0) 
+		{
+            return -1;
+        }
+    }
+    
+    if (total > w->stage_size) 
+	{
+        /*超过暂存区大小的记录直接写入文件*/ 
+        if (rotation_writer_open(ctx) < 0) 
+		{
+            return -1;
+        }
+        lfs_ssize_t written = 0;
+        if (head_len > 0) 
+		{
+            written = lfs_file_write(ctx->lfs, &w->file, head, head_len);
+        }
+        if (written >= 0) 
+		{
+            written = lfs_file_write(ctx->lfs, &w->file, data, size);
+        }
+        w->dirty = 1;
+        if (written < 0) 
+		{
+            /*文件末尾可能留下半条记录，后面的记录写入下一个文件*/ 
+            always_Print(0, ("Failed to write log file, error: %d\r\n", (int)written));
+            ctx->state.current_file_offset = ctx->max_file_size;
+            return -1;
+        }
+    }
+    else
+	{
+        if (head_len > 0) 
+		{
+            memcpy(&w->stage[w->stage_len], head, head_len);
+        }
+        memcpy(&w->stage[w->stage_len + head_len], data, size);
+        w->stage_len += total;
+    }
+    return 0;
+}
+
 
 /***************************************************************************************
-* 函 数 名: rotation_write
-* 功能说明: lfs内部flash擦除接口
-* 形   参: lfs  - 文件系统实例
-*		  data - 写入的数据
-*		  size - 大小
+* 函 数 名: rotation_append
+* 功能说明: 追加写入一条日志(可带帧头)，数据先进入暂存区，写满/超时/轮转时才写入Flash，
+*          同一条记录不会被拆分到两个文件
+* 形   参: ctx  	 - 轮转上下文
+*		  head 	 - 帧头，可为NULL
+*		  head_len - 帧头长度
+*		  data 	 - 写入的数据
+*		  size 	 - 大小
 * 返 回 值: written写入的字节数，-1失败
 ***************************************************************************************
 */
-int rotation_write(lfs_t *lfs, const void *data, uint32_t size)
+static int rotation_append(rotation_ctx_t *ctx, const void *head, uint32_t head_len, const void *data, uint32_t size)
 {
+    rotation_writer_t *w = &ctx->writer;
+    uint32_t total = head_len + size;
     if (data == NULL || size == 0) 
 	{
         return -1;
     }
      /*第一次写入时的初始化检查*/
-    if (g_rotation.active_file_count == 0) 
+    if (ctx->state.active_file_count == 0) 
 	{
-        g_rotation.active_file_count = 1;
-		lfs_setattr(lfs,ROTATION_INFO_FILE_NAME,ROTATION_ACTIVE_FILE_ID,
-					&g_rotation.active_file_count,sizeof(g_rotation.active_file_count));
+        ctx->state.active_file_count = 1;
+        ctx->state.newest_seq++;
         always_Print(0, ("First write, initialized active_file_count to 1\r\n"));
     }
     
-    /*检查当前文件是否需要轮转*/ 
-    if (g_rotation.current_file_offset + size >= MAX_FILE_SIZE) 
+    /*检查当前文件是否需要轮转，轮转前先把暂存数据写入旧文件*/ 
+    if (ctx->state.current_file_offset + total >= ctx->max_file_size) 
 	{
         always_Print(0, ("Current file full (%d + %d > %d), switching to next file\r\n",
-                       g_rotation.current_file_offset, size, MAX_FILE_SIZE));
-		switch_to_next_file(lfs);
+                       ctx->state.current_file_offset, total, ctx->max_file_size));
+		rotation_writer_close(ctx);
+		switch_to_next_file(ctx);
     }
     
-    /*生成当前文件名*/ 
-    char filename[FILENAME_BUFFER_SIZE];
-    generate_filename(g_rotation.newest_file_id, filename);
-	struct lfs_file_config fcfg = 
+    if (rotation_writer_put(ctx, head, head_len, data, size) < 0) 
 	{
-		.buffer = file_outer_buffer, 
-	};
-	
-    /*追加写入数据*/ 
-    lfs_file_t file;
-    int err = lfs_file_opencfg(lfs, &file, filename, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND,&fcfg);
-    if (err < 0) 
-	{
-        always_Print(0, ("Failed to open file: %s, error: %d\r\n", filename, err));
         return -1;
     }
+	ctx->state.current_file_offset += total;
+    
+    if ((uint32_t)(g_systick_ms - w->last_flush_ms) >= ROTATION_FLUSH_MS) 
+	{
+        rotation_writer_flush(ctx);
+    }
+    
+    return total;
+}
+
+
+/***************************************************************************************
+* 函 数 名: rotation_write
+* 功能说明: 轮转写入日志，使用模拟后端时记录预测耗时
+* 形   参: ctx  - 轮转上下文
+*		  data - 写入的数据
+*		  size - 大小
+* 返 回 值: written写入的字节数，-1失败
+***************************************************************************************
+*/
+static int rotation_write(rotation_ctx_t *ctx, const void *data, uint32_t size)
+{
+    LFS_LAT_BEGIN(ctx->lfs);
+    int ret = rotation_append(ctx, NULL, 0, data, size);
+    LFS_LAT_END(ctx->lfs, LFS_LAT_ROTATION_WRITE);
+    return ret;
+}
+
+
+/*
+***************************************************************************************
+* 函 数 名: rotation_write_record
+* 功能说明: 以帧格式写入一条记录：帧头(长度/时间戳/类型/CRC)+负载
+* 形   参: ctx  	 - 轮转上下文
+*		  rec_type - 记录类型 LOG_REC_*
+*		  ts_ms 	 - 时间戳
+*		  data 	 - 负载
+*		  size 	 - 负载长度
+* 返 回 值: 写入文件的字节数，-1失败
+***************************************************************************************
+*/
+static int rotation_write_record(rotation_ctx_t *ctx, uint8_t rec_type, uint32_t ts_ms, const void *data, uint32_t size)
+{
+    uint8_t hdr[LOG_REC_HDR_SIZE];
     
-    int written = lfs_file_write(lfs, &file, data, size);
-    if (written < 0) 
+    if (size == 0 || size > LOG_REC_MAX_PAYLOAD || size + LOG_REC_HDR_SIZE >= ctx->max_file_size) 
 	{
-        always_Print(0, ("Failed to write to file: %s, error: %d\r\n", filename, written));
-        lfs_file_close(lfs, &file);
         return -1;
     }
-	g_rotation.current_file_offset += written;
-	lfs_setattr(lfs,ROTATION_INFO_FILE_NAME,ROTATION_CURRENT_OFFSET_ID,
-				&g_rotation.current_file_offset,sizeof(g_rotation.current_file_offset));
-//	lfs_setattr(lfs,ROTATION_INFO_FILE_NAME,ROTATION_NEWEST_FILE_ID,
-//			&g_rotation.newest_file_id,sizeof(g_rotation.newest_file_id));
-//	lfs_setattr(lfs,ROTATION_INFO_FILE_NAME,ROTATION_OLDEST_FILE_ID,
-//				&g_rotation.oldest_file_id,sizeof(g_rotation.oldest_file_id));
-    lfs_file_close(lfs, &file);
-	//lfs_file_sync(lfs, lfs_file_t *file);
-    always_Print(0, ("Written %d bytes to %s, offset now: %d\r\n", written, filename, g_rotation.current_file_offset));
     
-    return written;
+    hdr[0] = LOG_REC_SYNC;
+    hdr[1] = rec_type;
+    hdr[2] = (uint8_t)(size);
+    hdr[3] = (uint8_t)(size >> 8);
+    hdr[4] = (uint8_t)(ts_ms);
+    hdr[5] = (uint8_t)(ts_ms >> 8);
+    hdr[6] = (uint8_t)(ts_ms >> 16);
+    hdr[7] = (uint8_t)(ts_ms >> 24);
+    uint16_t crc = Crc16_Calc(0xFFFF, hdr, LOG_REC_HDR_SIZE - 2);
+    crc = Crc16_Calc(crc, data, size);
+    hdr[8] = (uint8_t)(crc);
+    hdr[9] = (uint8_t)(crc >> 8);
+    
+    LFS_LAT_BEGIN(ctx->lfs);
+    int ret = rotation_append(ctx, hdr, LOG_REC_HDR_SIZE, data, size);
+    LFS_LAT_END(ctx->lfs, LFS_LAT_ROTATION_WRITE);
+    return ret;
 }
 
 
 
 
+
+
+/*
+***************************************************************************************
+* 函 数 名: rotation_read_buffer
+* 功能说明: 获取读文件时使用的文件缓存，大小需与对应文件系统的cache_size一致
+* 形   参: ctx - 轮转上下文
+* 返 回 值: 文件缓存
+***************************************************************************************
+*/
+static uint8_t *rotation_read_buffer(rotation_ctx_t *ctx)
+{
+    return (ctx->lfs == &lfs_outer_flash) ? file_outer_buffer : file_inter_buffer;
+}
+
+
 /*
 ***************************************************************************************
 * 函 数 名: rotation_print_logs
 * 功能说明: 打印指定轮转文件的日志内容
-* 形   参: lfs 	  - 文件系统实例
+* 形   参: ctx 	  - 轮转上下文
 *		  file_id - 文件ID
 * 返 回 值: 无
 ***************************************************************************************
 */
-void rotation_print_logs(lfs_t *lfs, uint16_t file_id)
+void rotation_print_logs(rotation_ctx_t *ctx, uint16_t file_id)
 {
-    if (file_id >= MAX_ROTATION_FILES) 
+    if (file_id >= ctx->max_files) 
 	{
-        always_Print(0, ("Invalid file ID: %d (max: %d)\r\n", file_id, MAX_ROTATION_FILES - 1));
+        always_Print(0, ("Invalid file ID: %d (max: %d)\r\n", file_id, ctx->max_files - 1));
         return;
     }
     
     char filename[FILENAME_BUFFER_SIZE];
-    generate_filename(file_id, filename);
+    generate_filename(ctx, file_id, filename);
     
     lfs_file_t file;
     struct lfs_file_config fcfg = 
 	{
-        .buffer = file_inter_buffer,
+        .buffer = rotation_read_buffer(ctx),
     };
     
     /*打开日志文件进行读取*/ 
-    int err = lfs_file_opencfg(lfs, &file, filename, LFS_O_RDONLY, &fcfg);
+    int err = lfs_file_opencfg(ctx->lfs, &file, filename, LFS_O_RDONLY, &fcfg);
     if (err < 0) 
 	{
         always_Print(0, ("Error: Failed to open log file %s for reading. Code: %d\r\n", filename, err));
@@ -647,86 +1195,74 @@ void rotation_print_logs(lfs_t *lfs, uint16_t file_id)
     }
     
     /*获取文件大小*/ 
-    lfs_soff_t file_size = lfs_file_size(lfs, &file);
+    lfs_soff_t file_size = lfs_file_size(ctx->lfs, &file);
     if (file_size < 0) {
         always_Print(0, ("Error: Failed to get file size for %s. Code: %d\r\n", filename, (int)file_size));
-        lfs_file_close(lfs, &file);
+        lfs_file_close(ctx->lfs, &file);
         return;
     }
     
     if (file_size == 0) 
 	{
         always_Print(0, ("Log file %s is empty.\r\n", filename));
-        lfs_file_close(lfs, &file);
+        lfs_file_close(ctx->lfs, &file);
         return;
     }
     
     always_Print(0, ("=== Log File %s Contents (Size: %d bytes) ===\r\n", filename, (int)file_size));
     
-    /*日志条目缓冲区，用于累积一条完整的日志*/ 
-    char log_entry[128]; 
-    int log_entry_pos = 0; 
-    int log_count = 0; 
-    lfs_soff_t total_read = 0;
+    lfs_file_close(ctx->lfs, &file);
+    
+    /*按块读取，逐条取出记录*/ 
+    static lfs_log_iter_t it;
+    lfs_log_rec_t rec;
+    char log_entry[128];
+    int log_count = 0;
+    int ret;
     
-    while (total_read < file_size) 
+    lfs_log_iter_open((uint8_t)(ctx - g_rot_ctx), &it, file_id);
+    while ((ret = lfs_log_iter_next(&it, &rec, log_entry, sizeof(log_entry) - 1)) > 0) 
 	{
-        char current_char;
-        /*读取一个字节*/ 
-        lfs_ssize_t bytes_read = lfs_file_read(lfs, &file, &current_char, 1);
-        if (bytes_read < 0) {
-            always_Print(0, ("Error: Failed to read from file %s. Code: %d\r\n", filename, (int)bytes_read));
-            break;
-        }
-        
-		/*达到文件末尾*/ 
-        if (bytes_read == 0) 
+        log_count++;
+#if LOG_RECORD_FRAMED
+        if (rec.flags & LOG_ITER_INCOMPLETE) 
 		{
-            break; 
+            /*最新文件的最后一条记录没有写完整(掉电)*/ 
+            always_Print(0, ("[%s] torn record at %d (%d bytes missing)\r\n", filename, (int)rec.offset, 
+                           (int)(rec.offset + LOG_REC_HDR_SIZE + rec.len - file_size)));
+            log_count--;
+            continue;
         }
-        total_read++;
-        
-        /* 检查是否是日志结束符'/' */ 
-        if (current_char == '/') 
-		{
-            if (log_entry_pos > 0) 
-			{
-                log_entry[log_entry_pos] = '\0';
-                log_count++;
-                always_Print(0, ("[%s:%d] %s\r\n", filename, log_count, log_entry));
-                log_entry_pos = 0; 
-            }
-        } 
-		else 
+        if (rec.type != LOG_REC_TEXT) 
 		{
-            if (log_entry_pos < sizeof(log_entry) - 1) 
+            always_Print(0, ("[%s:%d @%u] type=%d len=%d:", filename, log_count, rec.ts_ms, rec.type, rec.len));
+            for (uint16_t i = 0; i < rec.stored && i < 32; i++) 
 			{
-                log_entry[log_entry_pos] = current_char;
-                log_entry_pos++;
-            } 
-			else
-			{
-                log_entry[sizeof(log_entry) - 1] = '\0';
-                log_count++;
-                always_Print(0, ("[%s:%d] %s (TRUNCATED)\r\n", filename, log_count, log_entry));
-                log_entry_pos = 0;
-                
-                log_entry[log_entry_pos] = current_char;
-                log_entry_pos++;
+                always_Print(0, (" %02X", (uint8_t)log_entry[i]));
             }
+            always_Print(0, ("\r\n"));
+            continue;
         }
+        log_entry[rec.stored] = '\0';
+        always_Print(0, ("[%s:%d @%u] %s%s\r\n", filename, log_count, rec.ts_ms, log_entry, 
+                       (rec.flags & LOG_ITER_TRUNCATED) ? " (TRUNCATED)" : ""));
+#else
+        log_entry[rec.stored] = '\0';
+        always_Print(0, ("[%s:%d] %s%s\r\n", filename, log_count, log_entry, 
+                       (rec.flags & LOG_ITER_TRUNCATED) ? " (TRUNCATED)" : 
+                       (rec.flags & LOG_ITER_INCOMPLETE) ? " (INCOMPLETE)" : ""));
+#endif
     }
-    
-    /*处理最后一条未完成的日志（如果存在）*/ 
-    if (log_entry_pos > 0) {
-        log_entry[log_entry_pos] = '\0';
-        log_count++;
-        always_Print(0, ("[%s:%d] %s (INCOMPLETE)\r\n", filename, log_count, log_entry));
+    if (ret < 0) 
+	{
+        always_Print(0, ("Error: Failed to read from file %s. Code: %d\r\n", filename, ret));
+    }
+    if (it.skipped > 0) 
+	{
+        always_Print(0, ("[%s] %d bytes skipped while resyncing\r\n", filename, (int)it.skipped));
     }
     
     always_Print(0, ("=== File %s: Total %d log entries found ===\r\n", filename, log_count));
-    
-    lfs_file_close(lfs, &file);
 }
 
 
@@ -734,52 +1270,52 @@ void rotation_print_logs(lfs_t *lfs, uint16_t file_id)
 ***************************************************************************************
 * 函 数 名: rotation_print_all_logs
 * 功能说明: 打印所有轮转文件的日志内容（按时间顺序）
-* 形   参: lfs 	  - 文件系统实例
+* 形   参: ctx 	  - 轮转上下文
 * 返 回 值: 无
 ***************************************************************************************
 */
-void rotation_print_all_logs(lfs_t *lfs)
+void rotation_print_all_logs(rotation_ctx_t *ctx)
 {
    
-    if (g_rotation.active_file_count == 0) 
+    if (ctx->state.active_file_count == 0) 
 	{
         always_Print(0, ("No active rotation files found\r\n"));
         return;
     }
     
     always_Print(0, ("=== Printing All Rotation Logs (Chronological Order) ===\r\n"));
-    always_Print(0, ("Total active files: %d\r\n", g_rotation.active_file_count));
-    always_Print(0, ("File range: %d to %d\r\n", g_rotation.oldest_file_id, g_rotation.newest_file_id));
+    always_Print(0, ("Total active files: %d\r\n", ctx->state.active_file_count));
+    always_Print(0, ("File range: %d to %d\r\n", ctx->state.oldest_file_id, ctx->state.newest_file_id));
     
     /*从最旧的文件开始打印到最新的文件*/ 
-    uint16_t current_id = g_rotation.oldest_file_id;
+    uint16_t current_id = ctx->state.oldest_file_id;
     int files_printed = 0;
     
-    while (files_printed < g_rotation.active_file_count) 
+    while (files_printed < ctx->state.active_file_count) 
 	{
         char filename[FILENAME_BUFFER_SIZE];
-        generate_filename(current_id, filename);
+        generate_filename(ctx, current_id, filename);
         
         lfs_file_t test_file;
         struct lfs_file_config fcfg = 
 		{
-            .buffer = file_inter_buffer,
+            .buffer = rotation_read_buffer(ctx),
         };
         
-        int err = lfs_file_opencfg(lfs, &test_file, filename, LFS_O_RDONLY, &fcfg);
+        int err = lfs_file_opencfg(ctx->lfs, &test_file, filename, LFS_O_RDONLY, &fcfg);
         if (err >= 0) 
 		{
-            lfs_file_close(lfs, &test_file);
+            lfs_file_close(ctx->lfs, &test_file);
             
             /*文件存在，打印其内容*/ 
-            always_Print(0, ("--- File %d/%d ---\r\n", files_printed + 1, g_rotation.active_file_count));
-            rotation_print_logs(lfs, current_id);
+            always_Print(0, ("--- File %d/%d ---\r\n", files_printed + 1, ctx->state.active_file_count));
+            rotation_print_logs(ctx, current_id);
             files_printed++;
         }
         
-        current_id = (current_id + 1) % MAX_ROTATION_FILES;
+        current_id = (current_id + 1) % ctx->max_files;
         
-        if (current_id == g_rotation.oldest_file_id && files_printed > 0) 
+        if (current_id == ctx->state.oldest_file_id && files_printed > 0) 
 		{
             break;
         }
@@ -794,20 +1330,46 @@ void rotation_print_all_logs(lfs_t *lfs)
 
 /*
 ***************************************************************************************
-* 函 数 名: lfs_inter_flash_init
-* 功能说明: lfs内部flash初始化
-* 形   参: 无
+* 函 数 名: rotation_restore_fs
+* 功能说明: 恢复某个文件系统上所有日志通道的轮转状态
+* 形   参: lfs - 文件系统实例
 * 返 回 值: 无
 ***************************************************************************************
 */
-static void lfs_inter_flash_init(void)
+static void rotation_restore_fs(lfs_t *lfs)
 {
-    uint16_t init_flag = *((volatile uint16_t*)LFS_INTER_FLASH_START_ADDR);
-	
-	/*第一次挂载判断*/
-    if (init_flag == 0xFFFF) 
-	{  
-        lfs_format(&lfs_inter_flash, &inter_cfg);
+	for (uint8_t ch = 0; ch < LOG_CHANNEL_NUM; ch++)
+	{
+		rotation_ctx_t *ctx = &g_rot_ctx[ch];
+		if (ctx->lfs != lfs)
+		{
+			continue;
+		}
+		rotation_restore(ctx);
+		always_Print(0, ("[%s] newest_file_id = %d, oldest_file_id = %d, current_file_offset = %d, active_file_count = %d\r\n",
+		               ctx->prefix, ctx->state.newest_file_id, ctx->state.oldest_file_id,
+		               ctx->state.current_file_offset, ctx->state.active_file_count));
+	}
+}
+
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_inter_flash_init
+* 功能说明: lfs内部flash初始化
+* 形   参: 无
+* 返 回 值: 无
+***************************************************************************************
+*/
+static void lfs_inter_flash_init(void)
+{
+    uint8_t init_flag[2] = {0};
+	inter_cfg.read(&inter_cfg, 0, 0, init_flag, 2);
+	
+	/*第一次挂载判断*/
+    if (init_flag[0] == 0xFF && init_flag[1] == 0xFF) 
+	{  
+        lfs_format(&lfs_inter_flash, &inter_cfg);
 		int err = lfs_mount(&lfs_inter_flash, &inter_cfg);
 		if(err) 
 		{
@@ -827,7 +1389,7 @@ static void lfs_inter_flash_init(void)
 		return;
 	}
 	always_Print(0, ("param_init: loading all parameters from flash\r\n"));
-
+	rotation_restore_fs(&lfs_inter_flash);
 }
 
 
@@ -841,13 +1403,8 @@ static void lfs_inter_flash_init(void)
 */
 static void lfs_outer_flash_init(void)
 {
-	struct lfs_file_config fcfg = 
-	{
-        .buffer = file_outer_buffer, 
-    };
-	lfs_file_t file;
-	u8 temp[2] = {0};
-	hal_GD25Q80_read(temp,0,2);
+	uint8_t temp[2] = {0};
+	outer_cfg.read(&outer_cfg, 0, 0, temp, 2);
     
 	/*第一次挂载判断*/
     if (temp[0] == 0xFF && temp[1] == 0xFF) 
@@ -865,20 +1422,7 @@ static void lfs_outer_flash_init(void)
 		lfs_mount(&lfs_outer_flash, &outer_cfg);
 	}
 	
-	lfs_file_opencfg(&lfs_outer_flash, &file,ROTATION_INFO_FILE_NAME,LFS_O_WRONLY | LFS_O_CREAT , &fcfg);
-	lfs_getattr(&lfs_outer_flash, ROTATION_INFO_FILE_NAME, ROTATION_NEWEST_FILE_ID, 
-				&g_rotation.newest_file_id, sizeof(g_rotation.newest_file_id));
-	lfs_getattr(&lfs_outer_flash, ROTATION_INFO_FILE_NAME, ROTATION_OLDEST_FILE_ID, 
-				&g_rotation.oldest_file_id, sizeof(g_rotation.oldest_file_id));
-	lfs_getattr(&lfs_outer_flash, ROTATION_INFO_FILE_NAME, ROTATION_CURRENT_OFFSET_ID, 
-				&g_rotation.current_file_offset, sizeof(g_rotation.current_file_offset));
-	lfs_getattr(&lfs_outer_flash,ROTATION_INFO_FILE_NAME,ROTATION_ACTIVE_FILE_ID,
-				&g_rotation.active_file_count,sizeof(g_rotation.active_file_count));
-	always_Print(0,("newest_file_id = %d\n",g_rotation.newest_file_id));
-	always_Print(0,("oldest_file_id = %d\n",g_rotation.oldest_file_id));
-	always_Print(0,("current_file_offset = %d\n",g_rotation.current_file_offset));
-	always_Print(0,("active_file_count = %d\n",g_rotation.active_file_count));
-	lfs_file_close(&lfs_outer_flash, &file);
+	rotation_restore_fs(&lfs_outer_flash);
 }
 
 
@@ -903,30 +1447,897 @@ static void lfs_outer_flash_init(void)
 */
 void lfs_print_logs(uint8_t type)
 {
-	#define INTER_FLASH		0
-	#define OUTER_FLASH		1
-	if(type == OUTER_FLASH)
+	rotation_ctx_t *ctx = rotation_get_ctx(type);
+	if(ctx == NULL)
 	{
-		rotation_print_all_logs(&lfs_outer_flash);
+		return;
 	}
-	if(type == INTER_FLASH)
+	rotation_writer_flush(ctx);
+	rotation_print_all_logs(ctx);
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_log_flush
+* 功能说明: 立即将暂存区中的日志写入Flash
+* 形   参: type - 日志通道LOG_CH_xxx
+* 返 回 值: 0成功，-1失败
+***************************************************************************************
+*/
+int lfs_log_flush(uint8_t type)
+{
+	rotation_ctx_t *ctx = rotation_get_ctx(type);
+	if(ctx == NULL)
 	{
-		rotation_print_all_logs(&lfs_inter_flash);
+		return -1;
 	}
-	#undef INTER_FLASH
-	#undef OUTER_FLASH
+	return rotation_writer_flush(ctx);
 }
 
-/*暂不需要实现*/
-int lfs_log_inter_read(void *logBuf, int maxBytesToRead)
+/*
+***************************************************************************************
+* 函 数 名: lfs_log_poll
+* 功能说明: 周期调用，暂存数据超过ROTATION_FLUSH_MS未刷新时写入Flash
+* 形   参: 无
+* 返 回 值: 无
+***************************************************************************************
+*/
+void lfs_log_poll(void)
+{
+	for(uint8_t ch = 0; ch < LOG_CHANNEL_NUM; ch++)
+	{
+		if((uint32_t)(g_systick_ms - g_rot_ctx[ch].writer.last_flush_ms) >= ROTATION_FLUSH_MS)
+		{
+			rotation_writer_flush(&g_rot_ctx[ch]);
+		}
+	}
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_log_cursor_open
+* 功能说明: 把游标定位到最旧一条日志
+* 形   参: type - 日志通道LOG_CH_xxx
+*		  cur  - 游标
+* 返 回 值: 无
+***************************************************************************************
+*/
+void lfs_log_cursor_open(uint8_t type, lfs_log_cursor_t *cur)
+{
+	rotation_ctx_t *ctx = rotation_get_ctx(type);
+	if (ctx == NULL)
+	{
+		return;
+	}
+	cur->seq = ctx->state.newest_seq - ctx->state.active_file_count + 1;
+	cur->offset = 0;
+	cur->lost_files = 0;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: rotation_cursor_io
+* 功能说明: 从游标处开始跨文件读取/跳过数据，每个文件一次整块读取；
+*          游标所在文件已被轮转删除时跳到最旧的文件并记录丢失的文件数；
+*          读到最新文件时先刷新暂存区，保证能读到刚写入的日志
+* 形   参: ctx - 轮转上下文
+*		  cur - 游标
+*		  buf - 数据缓冲区，为NULL时只移动游标
+*		  len - 最多读取/跳过的字节数
+*		  one_file - 1:读到当前文件末尾即停止，不进入下一个文件
+* 返 回 值: 实际读取/跳过的字节数，负数为lfs错误码
+***************************************************************************************
+*/
+static int rotation_cursor_io(rotation_ctx_t *ctx, lfs_log_cursor_t *cur, uint8_t *buf, int len, uint8_t one_file)
+{
+	int total = 0;
+
+	while (total < len && ctx->state.active_file_count > 0)
+	{
+		uint32_t oldest_seq = ctx->state.newest_seq - ctx->state.active_file_count + 1;
+		if ((int32_t)(cur->seq - oldest_seq) < 0)
+		{
+			cur->lost_files += oldest_seq - cur->seq;
+			cur->seq = oldest_seq;
+			cur->offset = 0;
+		}
+		if ((int32_t)(cur->seq - ctx->state.newest_seq) > 0)
+		{
+			break;
+		}
+		if (cur->seq == ctx->state.newest_seq)
+		{
+			rotation_writer_flush(ctx);
+		}
+
+		char filename[FILENAME_BUFFER_SIZE];
+		uint16_t file_id = (uint16_t)((ctx->state.newest_file_id + ctx->max_files
+		                   - (ctx->state.newest_seq - cur->seq) % ctx->max_files) % ctx->max_files);
+		generate_filename(ctx, file_id, filename);
+
+		lfs_file_t file;
+		struct lfs_file_config fcfg =
+		{
+			.buffer = rotation_read_buffer(ctx),
+		};
+		int err = lfs_file_opencfg(ctx->lfs, &file, filename, LFS_O_RDONLY, &fcfg);
+		lfs_soff_t size = 0;
+		if (err == 0)
+		{
+			size = lfs_file_size(ctx->lfs, &file);
+		}
+		else if (err != LFS_ERR_NOENT)
+		{
+			return (total > 0) ? total : err;
+		}
+
+		if (size <= (lfs_soff_t)cur->offset)
+		{
+			if (err == 0)
+			{
+				lfs_file_close(ctx->lfs, &file);
+			}
+			if (one_file || cur->seq == ctx->state.newest_seq)
+			{
+				break;
+			}
+			/*当前文件读完，进入下一个文件*/
+			cur->seq++;
+			cur->offset = 0;
+			continue;
+		}
+
+		int n = (int)(size - cur->offset);
+		if (n > len - total)
+		{
+			n = len - total;
+		}
+		if (buf != NULL)
+		{
+			lfs_file_seek(ctx->lfs, &file, cur->offset, LFS_SEEK_SET);
+			n = lfs_file_read(ctx->lfs, &file, &buf[total], n);
+		}
+		lfs_file_close(ctx->lfs, &file);
+		if (n < 0)
+		{
+			return (total > 0) ? total : n;
+		}
+		cur->offset += n;
+		total += n;
+	}
+	return total;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_log_cursor_read
+* 功能说明: 从游标处读取最多len字节的原始日志数据，跨文件连续读取，读完后游标前移
+* 形   参: type - 日志通道LOG_CH_xxx
+*		  cur  - 游标
+*		  buf  - 数据缓冲区
+*		  len  - 缓冲区大小
+* 返 回 值: 读取的字节数，0表示已读到最新，负数为lfs错误码
+***************************************************************************************
+*/
+int lfs_log_cursor_read(uint8_t type, lfs_log_cursor_t *cur, void *buf, int len)
+{
+	rotation_ctx_t *ctx = rotation_get_ctx(type);
+	if (ctx == NULL || cur == NULL || buf == NULL || len <= 0)
+	{
+		return LFS_ERR_INVAL;
+	}
+	return rotation_cursor_io(ctx, cur, (uint8_t *)buf, len, 0);
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_log_cursor_read_records
+* 功能说明: 从游标处读取尽可能多的完整记录，游标停在最后一条完整记录之后。
+*          用记录迭代器逐个文件取记录，帧格式校验CRC，损坏的数据在块缓冲内查找同步字节跳过；
+*          帧格式输出帧头+负载，文本格式输出日志+'/'。
+*          最新文件末尾不完整的记录不输出，游标停在它前面，等写完后再读
+* 形   参: type - 日志通道LOG_CH_xxx
+*		  cur  - 游标
+*		  buf  - 数据缓冲区
+*		  len  - 缓冲区大小
+* 返 回 值: 读取的字节数(整条记录)，0表示已读到最新，LFS_ERR_NOMEM表示缓冲区放不下一条记录
+***************************************************************************************
+*/
+int lfs_log_cursor_read_records(uint8_t type, lfs_log_cursor_t *cur, void *buf, int len)
+{
+	static lfs_log_iter_t it;
+	rotation_ctx_t *ctx = rotation_get_ctx(type);
+	uint8_t *p = (uint8_t *)buf;
+	lfs_log_rec_t rec;
+	int total = 0;
+	int ret = 0;
+
+	if (ctx == NULL || cur == NULL || buf == NULL || len <= 0)
+	{
+		return LFS_ERR_INVAL;
+	}
+
+	lfs_log_iter_open(type, &it, -1);
+	it.cur = *cur;
+	for (;;)
+	{
+#if LOG_RECORD_FRAMED
+		int head = LOG_REC_HDR_SIZE;
+#else
+		int head = 0;
+#endif
+		int room = len - total - head;
+#if !LOG_RECORD_FRAMED
+		room--;     /*留出结尾的'/'*/
+#endif
+		if (room < 0)
+		{
+			room = 0;
+		}
+		int r = lfs_log_iter_next(&it, &rec, &p[total + head], room);
+		if (r <= 0)
+		{
+			/*后面已没有完整记录，跳过的损坏数据也不必再读*/
+			if (r < 0)
+			{
+				ret = r;
+				break;
+			}
+			*cur = it.cur;
+			cur->offset -= it.chunk_len - it.chunk_pos;
+			break;
+		}
+		if ((rec.flags & LOG_ITER_TRUNCATED)
+		    || ((rec.flags & LOG_ITER_INCOMPLETE) && rec.seq == ctx->state.newest_seq))
+		{
+			/*放不下或最新文件还没写完，游标停在这条记录前面*/
+			if (total == 0 && (rec.flags & LOG_ITER_TRUNCATED))
+			{
+				ret = LFS_ERR_NOMEM;
+			}
+			cur->seq = rec.seq;
+			cur->offset = rec.offset;
+			cur->lost_files = it.cur.lost_files;
+			break;
+		}
+#if LOG_RECORD_FRAMED
+		p[total + 0] = LOG_REC_SYNC;
+		p[total + 1] = rec.type;
+		p[total + 2] = (uint8_t)(rec.len);
+		p[total + 3] = (uint8_t)(rec.len >> 8);
+		p[total + 4] = (uint8_t)(rec.ts_ms);
+		p[total + 5] = (uint8_t)(rec.ts_ms >> 8);
+		p[total + 6] = (uint8_t)(rec.ts_ms >> 16);
+		p[total + 7] = (uint8_t)(rec.ts_ms >> 24);
+		p[total + 8] = (uint8_t)(rec.crc);
+		p[total + 9] = (uint8_t)(rec.crc >> 8);
+		total += LOG_REC_HDR_SIZE + rec.stored;
+#else
+		total += rec.stored;
+		p[total++] = '/';
+#endif
+		/*游标前移到这条记录之后*/
+		*cur = it.cur;
+		cur->offset -= it.chunk_len - it.chunk_pos;
+	}
+	lfs_log_iter_close(&it);
+	return (total > 0) ? total : ret;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_log_iter_open
+* 功能说明: 初始化记录迭代器
+* 形   参: type    - 日志通道LOG_CH_xxx
+*		  it      - 迭代器
+*		  file_id - 只遍历该轮转文件；<0表示从最旧的文件遍历到最新的文件
+* 返 回 值: 无
+***************************************************************************************
+*/
+void lfs_log_iter_open(uint8_t type, lfs_log_iter_t *it, int file_id)
+{
+	rotation_ctx_t *ctx = rotation_get_ctx(type);
+	if (ctx == NULL)
+	{
+		type = LOG_CH_INTER;
+		ctx = &g_rot_ctx[type];
+	}
+	lfs_log_cursor_open(type, &it->cur);
+	it->type = type;
+	it->one_file = (file_id >= 0);
+	if (it->one_file)
+	{
+		it->cur.seq = ctx->state.newest_seq - (uint32_t)((ctx->state.newest_file_id + ctx->max_files
+		              - (uint16_t)file_id) % ctx->max_files);
+	}
+	it->chunk_len = 0;
+	it->chunk_pos = 0;
+	it->index = 0;
+	it->skipped = 0;
+	it->file_open = 0;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_log_iter_close
+* 功能说明: 关闭迭代器打开的文件。遍历到结束或出错时lfs_log_iter_next会自动关闭，
+*          提前结束遍历时调用，可重复调用
+* 形   参: it - 迭代器
+* 返 回 值: 无
+***************************************************************************************
+*/
+void lfs_log_iter_close(lfs_log_iter_t *it)
+{
+	if (it->file_open)
+	{
+		lfs_file_close(g_rot_ctx[it->type].lfs, &it->file);
+		it->file_open = 0;
+	}
+}
+
+/*
+***************************************************************************************
+* 函 数 名: log_iter_read
+* 功能说明: 从游标处读取当前文件的数据。文件在多次读取间保持打开，只在换文件时重新打开；
+*          打开时是最新文件的，读到末尾时刷新暂存区并重新打开一次，读到新写入的数据；
+*          游标所在文件已被轮转删除时跳到最旧的文件并记录丢失的文件数
+* 形   参: it  - 迭代器
+*		  buf - 数据缓冲区
+*		  len - 最多读取的字节数
+* 返 回 值: 实际读取的字节数，0表示当前文件已读完，负数为lfs错误码
+***************************************************************************************
+*/
+static int log_iter_read(lfs_log_iter_t *it, uint8_t *buf, int len)
+{
+	rotation_ctx_t *ctx = &g_rot_ctx[it->type];
+
+	if (ctx->state.active_file_count == 0)
+	{
+		lfs_log_iter_close(it);
+		return 0;
+	}
+	uint32_t oldest_seq = ctx->state.newest_seq - ctx->state.active_file_count + 1;
+	if ((int32_t)(it->cur.seq - oldest_seq) < 0)
+	{
+		it->cur.lost_files += oldest_seq - it->cur.seq;
+		it->cur.seq = oldest_seq;
+		it->cur.offset = 0;
+	}
+	if ((int32_t)(it->cur.seq - ctx->state.newest_seq) > 0)
+	{
+		return 0;
+	}
+	if (it->file_open && it->file_seq != it->cur.seq)
+	{
+		lfs_log_iter_close(it);
+	}
+
+	for (;;)
+	{
+		uint8_t fresh = 0;
+		if (!it->file_open)
+		{
+			char filename[FILENAME_BUFFER_SIZE];
+			uint16_t file_id = (uint16_t)((ctx->state.newest_file_id + ctx->max_files
+			                   - (ctx->state.newest_seq - it->cur.seq) % ctx->max_files) % ctx->max_files);
+			it->file_live = (it->cur.seq == ctx->state.newest_seq);
+			if (it->file_live)
+			{
+				rotation_writer_flush(ctx);
+			}
+			generate_filename(ctx, file_id, filename);
+			memset(&it->fcfg, 0, sizeof(it->fcfg));
+			it->fcfg.buffer = it->file_buffer;
+			int err = lfs_file_opencfg(ctx->lfs, &it->file, filename, LFS_O_RDONLY, &it->fcfg);
+			if (err == LFS_ERR_NOENT)
+			{
+				return 0;
+			}
+			if (err < 0)
+			{
+				return err;
+			}
+			it->file_open = 1;
+			it->file_seq = it->cur.seq;
+			fresh = 1;
+		}
+
+		if (lfs_file_tell(ctx->lfs, &it->file) != (lfs_soff_t)it->cur.offset)
+		{
+			lfs_soff_t pos = lfs_file_seek(ctx->lfs, &it->file, it->cur.offset, LFS_SEEK_SET);
+			if (pos < 0)
+			{
+				return (int)pos;
+			}
+		}
+		int n = lfs_file_read(ctx->lfs, &it->file, buf, len);
+		if (n > 0)
+		{
+			it->cur.offset += n;
+		}
+		if (n != 0 || fresh || !it->file_live)
+		{
+			return n;
+		}
+		/*最新文件读到末尾，重新打开看写入端是否追加了数据*/
+		lfs_log_iter_close(it);
+	}
+}
+
+/*
+***************************************************************************************
+* 函 数 名: log_iter_need
+* 功能说明: 保证块缓冲中至少有need字节未处理的数据，不足时把剩余数据移到开头并按块补读，
+*          只在当前文件内读取
+* 形   参: it   - 迭代器
+*		  need - 需要的字节数，不能超过LOG_ITER_CHUNK_SIZE
+* 返 回 值: 1满足，0当前文件剩余数据不足，负数为lfs错误码
+***************************************************************************************
+*/
+static int log_iter_need(lfs_log_iter_t *it, int need)
+{
+	int avail = it->chunk_len - it->chunk_pos;
+	if (avail >= need)
+	{
+		return 1;
+	}
+	if (it->chunk_pos > 0)
+	{
+		memmove(it->chunk, &it->chunk[it->chunk_pos], avail);
+		it->chunk_len = (uint16_t)avail;
+		it->chunk_pos = 0;
+	}
+	int n = log_iter_read(it, &it->chunk[it->chunk_len], LOG_ITER_CHUNK_SIZE - it->chunk_len);
+	if (n < 0)
+	{
+		return n;
+	}
+	it->chunk_len += (uint16_t)n;
+	return (it->chunk_len >= need) ? 1 : 0;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: log_iter_next_file
+* 功能说明: 当前文件遍历完后进入下一个文件
+* 形   参: it - 迭代器
+* 返 回 值: 1已进入下一个文件，0没有更多文件
+***************************************************************************************
+*/
+static int log_iter_next_file(lfs_log_iter_t *it)
 {
+	const rotation_ctx_t *ctx = &g_rot_ctx[it->type];
+	if (it->one_file || ctx->state.active_file_count == 0
+	    || (int32_t)(it->cur.seq - ctx->state.newest_seq) >= 0)
+	{
+		return 0;
+	}
+	it->cur.seq++;
+	it->cur.offset = 0;
+	it->chunk_len = 0;
+	it->chunk_pos = 0;
+	it->index = 0;
 	return 1;
 }
 
+/*
+***************************************************************************************
+* 函 数 名: log_iter_begin
+* 功能说明: 记下块缓冲当前位置对应的文件和偏移，作为一条记录的起点
+* 形   参: it  - 迭代器
+*		  rec - 记录信息
+* 返 回 值: 无
+***************************************************************************************
+*/
+static void log_iter_begin(const lfs_log_iter_t *it, lfs_log_rec_t *rec)
+{
+	const rotation_ctx_t *ctx = &g_rot_ctx[it->type];
+	rec->seq = it->cur.seq;
+	rec->file_id = (uint16_t)((ctx->state.newest_file_id + ctx->max_files
+	               - (ctx->state.newest_seq - it->cur.seq) % ctx->max_files) % ctx->max_files);
+	rec->offset = it->cur.offset - (it->chunk_len - it->chunk_pos);
+	rec->index = it->index;
+	rec->type = LOG_REC_TEXT;
+	rec->flags = 0;
+	rec->ts_ms = 0;
+	rec->len = 0;
+	rec->stored = 0;
+	rec->crc = 0;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: log_iter_next
+* 功能说明: 取出下一条记录。文件按块读入块缓冲，文本格式用memchr查找'/'分隔，
+*          帧格式按帧头长度取负载并校验CRC，跨块的记录在块缓冲中续接。
+*          帧长度越过文件末尾时，只有最新文件的末尾才算掉电写了一半的记录，
+*          其它位置按帧头损坏处理，与CRC错误一样从帧头后1字节重新同步
+* 形   参: it   - 迭代器
+*		  rec  - 输出记录信息
+*		  buf  - 记录内容缓冲区
+*		  size - 缓冲区大小，记录超长时只保存前size字节并置LOG_ITER_TRUNCATED
+* 返 回 值: 1取到一条记录，0遍历结束，负数为lfs错误码
+***************************************************************************************
+*/
+static int log_iter_next(lfs_log_iter_t *it, lfs_log_rec_t *rec, void *buf, int size)
+{
+	uint8_t *out = (uint8_t *)buf;
+
+#if LOG_RECORD_FRAMED
+	for (;;)
+	{
+		int r = log_iter_need(it, LOG_REC_HDR_SIZE);
+		if (r < 0)
+		{
+			return r;
+		}
+		if (r == 0)
+		{
+			/*文件末尾不足一个帧头的数据丢弃*/
+			it->chunk_pos = it->chunk_len;
+			if (log_iter_next_file(it))
+			{
+				continue;
+			}
+			return 0;
+		}
+
+		uint8_t *p = &it->chunk[it->chunk_pos];
+		int avail = it->chunk_len - it->chunk_pos;
+		if (p[0] != LOG_REC_SYNC)
+		{
+			uint8_t *sync = memchr(p, LOG_REC_SYNC, avail);
+			int skip = (sync != NULL) ? (int)(sync - p) : avail;
+			it->skipped += skip;
+			it->chunk_pos += (uint16_t)skip;
+			continue;
+		}
+		uint16_t len = (uint16_t)(p[2] | (p[3] << 8));
+		if (len == 0 || len > LOG_REC_MAX_PAYLOAD || len + LOG_REC_HDR_SIZE > g_rot_ctx[it->type].max_file_size)
+		{
+			it->skipped++;
+			it->chunk_pos++;
+			continue;
+		}
+
+		log_iter_begin(it, rec);
+		rec->type = p[1];
+		rec->ts_ms = (uint32_t)p[4] | ((uint32_t)p[5] << 8) | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+		rec->len = len;
+		rec->crc = (uint16_t)(p[8] | (p[9] << 8));
+		uint16_t calc = Crc16_Calc(0xFFFF, p, LOG_REC_HDR_SIZE - 2);
+		it->chunk_pos += LOG_REC_HDR_SIZE;
+
+		/*负载可能跨块，边读边算CRC*/
+		uint16_t left = len;
+		while (left > 0)
+		{
+			r = log_iter_need(it, 1);
+			if (r <= 0)
+			{
+				break;
+			}
+			uint16_t n = (uint16_t)(it->chunk_len - it->chunk_pos);
+			if (n > left)
+			{
+				n = left;
+			}
+			calc = Crc16_Calc(calc, &it->chunk[it->chunk_pos], n);
+			if (rec->stored < size)
+			{
+				uint16_t keep = (uint16_t)(size - rec->stored);
+				if (keep > n)
+				{
+					keep = n;
+				}
+				memcpy(&out[rec->stored], &it->chunk[it->chunk_pos], keep);
+				rec->stored += keep;
+			}
+			it->chunk_pos += n;
+			left -= n;
+		}
+		if (r < 0)
+		{
+			return r;
+		}
+		if (left > 0 && rec->seq == g_rot_ctx[it->type].state.newest_seq)
+		{
+			/*最新文件的最后一条记录没有写完整(掉电)*/
+			rec->flags = LOG_ITER_INCOMPLETE;
+			it->index++;
+			return 1;
+		}
+		if (left > 0 || calc != rec->crc)
+		{
+			/*长度越过文件末尾或CRC不符，回到帧头后1字节重新同步*/
+			it->skipped++;
+			it->cur.seq = rec->seq;
+			it->cur.offset = rec->offset + 1;
+			it->chunk_len = 0;
+			it->chunk_pos = 0;
+			continue;
+		}
+		if (rec->stored < len)
+		{
+			rec->flags = LOG_ITER_TRUNCATED;
+		}
+		it->index++;
+		return 1;
+	}
+#else
+	int started = 0;
+	for (;;)
+	{
+		int r = log_iter_need(it, 1);
+		if (r < 0)
+		{
+			return r;
+		}
+		if (r == 0)
+		{
+			if (started && rec->stored > 0)
+			{
+				/*文件末尾没有结束符的日志*/
+				rec->len = rec->stored;
+				rec->flags = LOG_ITER_INCOMPLETE;
+				it->index++;
+				log_iter_next_file(it);
+				return 1;
+			}
+			if (log_iter_next_file(it))
+			{
+				started = 0;
+				continue;
+			}
+			return 0;
+		}
+
+		if (!started)
+		{
+			log_iter_begin(it, rec);
+			started = 1;
+		}
+		uint8_t *p = &it->chunk[it->chunk_pos];
+		int avail = it->chunk_len - it->chunk_pos;
+		uint8_t *end = memchr(p, '/', avail);
+		int take = (end != NULL) ? (int)(end - p) : avail;
+		if (take > size - rec->stored)
+		{
+			/*超长的日志截断输出，剩余部分作为下一条*/
+			take = size - rec->stored;
+			memcpy(&out[rec->stored], p, take);
+			rec->stored += take;
+			rec->len = rec->stored;
+			it->chunk_pos += (uint16_t)take;
+			rec->flags = LOG_ITER_TRUNCATED;
+			it->index++;
+			return 1;
+		}
+		memcpy(&out[rec->stored], p, take);
+		rec->stored += take;
+		it->chunk_pos += (uint16_t)take;
+		if (end != NULL)
+		{
+			it->chunk_pos++;
+			if (rec->stored > 0)
+			{
+				rec->len = rec->stored;
+				it->index++;
+				return 1;
+			}
+			/*空日志跳过*/
+			started = 0;
+		}
+	}
+#endif
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_log_iter_next
+* 功能说明: 取出下一条记录，遍历结束或出错时关闭迭代器打开的文件
+* 形   参: it   - 迭代器
+*		  rec  - 输出记录信息
+*		  buf  - 记录内容缓冲区
+*		  size - 缓冲区大小，记录超长时只保存前size字节并置LOG_ITER_TRUNCATED
+* 返 回 值: 1取到一条记录，0遍历结束，负数为lfs错误码
+***************************************************************************************
+*/
+int lfs_log_iter_next(lfs_log_iter_t *it, lfs_log_rec_t *rec, void *buf, int size)
+{
+	int r = log_iter_next(it, rec, buf, size);
+	if (r <= 0)
+	{
+		lfs_log_iter_close(it);
+	}
+	return r;
+}
+
+static lfs_log_cursor_t g_read_cursor[LOG_CHANNEL_NUM];
+static uint8_t g_read_cursor_open[LOG_CHANNEL_NUM];
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_log_read_rewind
+* 功能说明: 把hal_logNVM_Read使用的游标重新定位到最旧的日志
+* 形   参: type - 日志通道LOG_CH_xxx
+* 返 回 值: 无
+***************************************************************************************
+*/
+void lfs_log_read_rewind(uint8_t type)
+{
+	if (type >= LOG_CHANNEL_NUM)
+	{
+		return;
+	}
+	lfs_log_cursor_open(type, &g_read_cursor[type]);
+	g_read_cursor_open[type] = 1;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_log_read
+* 功能说明: 增量读取日志，第一次从最旧的日志开始，之后从上次读取结束处继续
+* 形   参: type 		 - 日志通道LOG_CH_xxx
+*		  logBuf 		 - 数据缓冲区
+*		  maxBytesToRead - 缓冲区大小
+* 返 回 值: 读取的字节数，0表示没有新数据
+***************************************************************************************
+*/
+int lfs_log_read(uint8_t type, void *logBuf, int maxBytesToRead)
+{
+	if (type >= LOG_CHANNEL_NUM)
+	{
+		return LFS_ERR_INVAL;
+	}
+	if (!g_read_cursor_open[type])
+	{
+		lfs_log_read_rewind(type);
+	}
+	return lfs_log_cursor_read(type, &g_read_cursor[type], logBuf, maxBytesToRead);
+}
+
+int lfs_log_inter_read(void *logBuf, int maxBytesToRead)
+{
+	return lfs_log_read(LOG_CH_INTER, logBuf, maxBytesToRead);
+}
+
 int lfs_log_outer_read(void *logBuf, int maxBytesToRead)
 {
-	return 1;
+	return lfs_log_read(LOG_CH_OUTER, logBuf, maxBytesToRead);
+}
+#if LFS_PORT_USE_EMU
+/*
+***************************************************************************************
+* 函 数 名: lfs_port_emu
+* 功能说明: 获取模拟设备实例，用于读取访问统计
+* 形   参: type - 0:内部Flash，1:外部Flash
+* 返 回 值: 模拟设备实例
+***************************************************************************************
+*/
+lfs_emu_t *lfs_port_emu(uint8_t type)
+{
+	return (type == 0) ? &inter_emu : &outer_emu;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_port_latency
+* 功能说明: 获取某类操作的预测耗时统计
+* 形   参: op - 操作类型
+* 返 回 值: 统计结构体指针
+***************************************************************************************
+*/
+const lfs_latency_t *lfs_port_latency(lfs_lat_op_t op)
+{
+	return &g_latency[op];
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_port_print_latency
+* 功能说明: 打印所有操作的预测耗时统计
+* 形   参: 无
+* 返 回 值: 无
+***************************************************************************************
+*/
+void lfs_port_print_latency(void)
+{
+	for (int i = 0; i < LFS_LAT_NUM; i++)
+	{
+		const lfs_latency_t *lat = &g_latency[i];
+		always_Print(0, ("%s: count=%u avg=%uus max=%uus worst=%uus spikes=%u\r\n", g_latency_name[i],
+		               lat->count, lat->count ? (uint32_t)(lat->total_us / lat->count) : 0,
+		               lat->max_us, lat->worst_us, lat->spikes));
+	}
+}
+
+/*
+***************************************************************************************
+* 函 数 名: lfs_port_bench_log_read
+* 功能说明: 读日志吞吐量对比：逐字节lfs_file_read与按块读取的记录迭代器，
+*          分别统计lfs调用次数、模拟设备读次数、主机耗时和按时序模型预测的片上耗时
+* 形   参: type - 日志通道LOG_CH_xxx
+* 返 回 值: 无
+***************************************************************************************
+*/
+void lfs_port_bench_log_read(uint8_t type)
+{
+	rotation_ctx_t *ctx = rotation_get_ctx(type);
+	if (ctx == NULL)
+	{
+		return;
+	}
+	lfs_emu_t *emu = lfs_port_emu((type == LOG_CH_INTER) ? 0 : 1);
+	lfs_emu_span_t span;
+	uint32_t reads;
+	uint32_t calls = 0;
+	uint32_t bytes = 0;
+	clock_t t0;
+	double host_us;
+
+	lfs_log_flush(type);
+
+	/*逐字节读取，与原rotation_print_logs的读法一致*/
+	lfs_emu_span_begin(emu, &span);
+	reads = emu->stats.reads;
+	t0 = clock();
+	for (uint16_t i = 0, id = ctx->state.oldest_file_id; i < ctx->state.active_file_count; i++)
+	{
+		char filename[FILENAME_BUFFER_SIZE];
+		lfs_file_t file;
+		struct lfs_file_config fcfg =
+		{
+			.buffer = rotation_read_buffer(ctx),
+		};
+		generate_filename(ctx, id, filename);
+		if (lfs_file_opencfg(ctx->lfs, &file, filename, LFS_O_RDONLY, &fcfg) == 0)
+		{
+			char c;
+			while (calls++, lfs_file_read(ctx->lfs, &file, &c, 1) == 1)
+			{
+				bytes++;
+			}
+			lfs_file_close(ctx->lfs, &file);
+		}
+		id = (id + 1) % ctx->max_files;
+	}
+	host_us = (double)(clock() - t0) * 1000000.0 / CLOCKS_PER_SEC;
+	lfs_emu_span_end(emu, &span);
+	always_Print(0, ("byte read : %u bytes, %u lfs calls, %u dev reads, host %.0fus (%.0f B/s), "
+	               "predicted %uus (%.0f B/s)\r\n", bytes, calls, emu->stats.reads - reads, host_us,
+	               host_us > 0 ? bytes * 1000000.0 / host_us : 0.0, span.typ_us,
+	               span.typ_us ? bytes * 1000000.0 / span.typ_us : 0.0));
+
+	/*记录迭代器*/
+	static lfs_log_iter_t it;
+	lfs_log_rec_t rec;
+	char entry[128];
+	uint32_t records = 0;
+
+	lfs_emu_span_begin(emu, &span);
+	reads = emu->stats.reads;
+	t0 = clock();
+	lfs_log_iter_open(type, &it, -1);
+	while (lfs_log_iter_next(&it, &rec, entry, sizeof(entry)) > 0)
+	{
+		records++;
+	}
+	host_us = (double)(clock() - t0) * 1000000.0 / CLOCKS_PER_SEC;
+	lfs_emu_span_end(emu, &span);
+	always_Print(0, ("chunk iter: %u bytes, %u records, %u dev reads, host %.0fus (%.0f B/s), "
+	               "predicted %uus (%.0f B/s)\r\n", bytes, records, emu->stats.reads - reads, host_us,
+	               host_us > 0 ? bytes * 1000000.0 / host_us : 0.0, span.typ_us,
+	               span.typ_us ? bytes * 1000000.0 / span.typ_us : 0.0));
 }
+
+#ifndef LFS_EMU_INTER_IMAGE
+#define LFS_EMU_INTER_IMAGE		NULL /*内部Flash镜像文件，NULL表示纯RAM*/
+#endif
+#ifndef LFS_EMU_OUTER_IMAGE
+#define LFS_EMU_OUTER_IMAGE		NULL /*外部Flash镜像文件，NULL表示纯RAM*/
+#endif
+
 /*
 ***************************************************************************************
 * 函 数 名: log_lfs_init
@@ -935,11 +2346,115 @@ int lfs_log_outer_read(void *logBuf, int maxBytesToRead)
 * 返 回 值: 无
 ***************************************************************************************
 */
+void log_lfs_init(void)
+{
+	const char *inter_image = LFS_EMU_INTER_IMAGE;
+	const char *outer_image = LFS_EMU_OUTER_IMAGE;
+
+	if (lfs_emu_init(&inter_emu, inter_emu_mem, inter_cfg.block_size, inter_cfg.block_count, 1, inter_image) != 0)
+	{
+		always_Print(0, ("inter emu: image %s load failed, starting erased\r\n", inter_image ? inter_image : "(none)"));
+	}
+	if (lfs_emu_init(&outer_emu, outer_emu_mem, outer_cfg.block_size, outer_cfg.block_count, 0, outer_image) != 0)
+	{
+		always_Print(0, ("outer emu: image %s load failed, starting erased\r\n", outer_image ? outer_image : "(none)"));
+	}
+	lfs_emu_set_timing(&inter_emu, &lfs_emu_timing_stm32f1);
+	lfs_emu_set_timing(&outer_emu, &lfs_emu_timing_gd25q80);
+
+	lfs_emu_span_t lat_span;
+	lfs_emu_span_begin(&inter_emu, &lat_span);
+	lfs_inter_flash_init();
+	lfs_emu_span_end(&inter_emu, &lat_span);
+	lfs_port_latency_record(LFS_LAT_MOUNT, &lat_span);
+	always_Print(0, ("inter mount: predicted %uus (worst %uus)\r\n", lat_span.typ_us, lat_span.max_us));
+
+	lfs_emu_span_begin(&outer_emu, &lat_span);
+	lfs_outer_flash_init();
+	lfs_emu_span_end(&outer_emu, &lat_span);
+	lfs_port_latency_record(LFS_LAT_MOUNT, &lat_span);
+	always_Print(0, ("outer mount: predicted %uus (worst %uus)\r\n", lat_span.typ_us, lat_span.max_us));
+}
+#else
 extern void hal_Delay_us(u32 ms);
+/*
+***************************************************************************************
+* 函 数 名: log_lfs_init
+* 功能说明: lfs初始化
+* 形   参:  无
+* 返 回 值: 无
+***************************************************************************************
+*/
 void log_lfs_init(void)
 {
 	lfs_inter_flash_init();
 	hal_Delay_us(100000); /*等待内部Flash初始化完成，必加，不然会报文件系统损坏*/ 
 	lfs_outer_flash_init();
 }
+#endif
+
+#if LFS_PORT_USE_EMU && defined(LFS_PORT_EMU_MAIN)
+#ifndef LFS_PORT_EMU_LOGS
+#define LFS_PORT_EMU_LOGS		2000 /*主机端驱动写入的日志条数*/
+#endif
 
+volatile uint32_t g_systick_ms;
+param_entry_t param_table[MAX_PARAMS] = {
+    {PARAM_ID_A,           PARAM_TYPE_INT,    {.i = 1},        sizeof(int)},
+};
+
+/*
+***************************************************************************************
+* 函 数 名: main
+* 功能说明: 主机端回归和基准入口：在模拟设备上挂载，写日志直到多次轮转，修改参数后读回，
+*          再遍历日志，打印预测耗时和设备访问次数。需要littlefs源码，如
+*          gcc -DLFS_PORT_USE_EMU=1 -DLFS_PORT_EMU_MAIN -I<工程头文件目录> -I<littlefs目录>
+*              lfs_port.c lfs_emu.c crc16.c <littlefs目录>/lfs.c <littlefs目录>/lfs_util.c
+* 形   参: 无
+* 返 回 值: 0通过，1参数读回不符或最新一条日志不是最后写入的
+***************************************************************************************
+*/
+int main(void)
+{
+	static lfs_log_iter_t it;
+	lfs_log_rec_t rec;
+	char msg[64];
+	char last[64];
+	int last_len = 0;
+	int value = 1234;
+	int fail = 0;
+
+	log_lfs_init();
+	for (uint32_t i = 0; i < LFS_PORT_EMU_LOGS; i++)
+	{
+		int n = sprintf(msg, "emu log #%u%s", (unsigned)i, LOG_RECORD_FRAMED ? "" : "/");
+		g_systick_ms += 10;
+		lfs_store_record(LOG_CH_OUTER, LOG_REC_TEXT, g_systick_ms, msg, n);
+	}
+	lfs_log_flush(LOG_CH_OUTER);
+
+	param_set(PARAM_ID_A, &value);
+	if (param_get_value(PARAM_ID_A).i != value)
+	{
+		always_Print(0, ("emu: param_A read back %d, expected %d\r\n", param_get_value(PARAM_ID_A).i, value));
+		fail = 1;
+	}
+
+	lfs_log_iter_open(LOG_CH_OUTER, &it, -1);
+	while (lfs_log_iter_next(&it, &rec, last, sizeof(last)) > 0)
+	{
+		last_len = rec.stored;
+	}
+	/*文本格式读回的日志不含结尾的'/'*/
+	if (last_len != (int)strlen(msg) - (LOG_RECORD_FRAMED ? 0 : 1) || memcmp(last, msg, last_len) != 0)
+	{
+		always_Print(0, ("emu: newest log does not match the last one written\r\n"));
+		fail = 1;
+	}
+
+	lfs_port_print_latency();
+	lfs_port_bench_log_read(LOG_CH_OUTER);
+	always_Print(0, ("emu: %s\r\n", fail ? "FAIL" : "PASS"));
+	return fail;
+}
+#endif
@@ -1,11 +1,50 @@
 #ifndef __LFS_PORT
 #define __LFS_PORT
 
+/*-------------------- 块设备后端 --------------------*/
+/*1:使用lfs_emu在主机上模拟内外部Flash，0:使用片上Flash和GD25Q80*/
+#ifndef LFS_PORT_USE_EMU
+#define LFS_PORT_USE_EMU			0
+#endif
+
+#if LFS_PORT_USE_EMU
+#include <stdint.h>
+#include <stdio.h>
+#include "lfs_emu.h"
+#if !defined(__CC_ARM) && !defined(__align)
+#define __align(n)	__attribute__((aligned(n)))
+#endif
+#else
 #include "stm32f10x.h"
+#endif
 #include "param_bridge.h"
+#include "lfs.h"
+/*-------------------- 日志通道 --------------------*/
+/*每个通道有独立的文件系统、文件前缀、文件个数、文件大小、轮转状态和写缓冲，互不挤占配额*/
+#define LOG_CH_INTER				0      /*内部Flash日志，对应INTER_FLASH*/
+#define LOG_CH_OUTER				1      /*外部Flash日志，对应OUTER_FLASH*/
+
+/*1:在外部Flash上增加故障/遥测/调试三个独立通道，外部Flash日志区相应扩大*/
+#ifndef LOG_EXTRA_CHANNELS
+#define LOG_EXTRA_CHANNELS			0
+#endif
+
+#if LOG_EXTRA_CHANNELS
+#define LOG_CH_FAULT				2      /*故障记录，调试信息再多也不会挤掉*/
+#define LOG_CH_TELEMETRY			3      /*遥测数据*/
+#define LOG_CH_DEBUG				4      /*调试信息*/
+#define LOG_CHANNEL_NUM				5
+#else
+#define LOG_CHANNEL_NUM				2
+#endif
+
 /*-------------------- 地址配置 --------------------*/
 #define OUTERFLASH_ADDR_START		0 /*外部区域的起始地址*/
+#if LOG_EXTRA_CHANNELS
+#define OUTER_BLOCK_NUM				32 /*日志区域所用页数*/
+#else
 #define OUTER_BLOCK_NUM				6 /*日志区域所用页数*/
+#endif
 
 #if defined(PCB_VCU_BOARD_P02) || defined(PCB_VCU_BOARD_P03)
 #define PAGE_SIZE					2048
@@ -21,17 +60,54 @@
 #define LFS_INTER_FLASH_SIZE        (BLOCK_NUM * PAGE_SIZE)   
 
 /*-------------------- 自动回滚 --------------------*/
+/*旧版本的轮转信息文件，只在挂载时用于给没有序号的旧日志文件补序号，迁移完成后删除*/
 #define ROTATION_INFO_FILE_NAME		"rotation.txt" /*轮状信息暂存的文件*/
 #define ROTATION_NEWEST_FILE_ID 	0x01 /*存储最新文件的ID*/
 #define ROTATION_OLDEST_FILE_ID 	0x02 /*存储最旧文件的ID*/
 #define ROTATION_CURRENT_OFFSET_ID 	0x03 /*存储最新文件写入偏移量的ID*/
 #define ROTATION_ACTIVE_FILE_ID		0x04 /*存储有效文件的ID*/
+/*每个轮转文件自带的序号属性，随文件第一次sync一起提交，挂载时据此恢复轮转状态*/
+#define ROTATION_FILE_SEQ_ID		0x05
 
 #define MAX_ROTATION_FILES     		3      /*轮状的文件个数*/
 #define FILE_PREFIX            		"log"  /*文件前缀 "log"*/ 
 #define FILE_EXTENSION         		".txt" /*文件扩展名*/ 
 #define MAX_FILE_SIZE          		4096   /*单个文件的大小*/      
 #define FILENAME_BUFFER_SIZE   		16     /*文件名暂存数组大小*/     
+#define ROTATION_FILES_LIMIT		8      /*单个通道轮转文件个数的上限*/
+
+#if LOG_EXTRA_CHANNELS
+/*扩展通道的文件个数和大小，文件前缀分别为flt/tlm/dbg*/
+#ifndef LOG_FAULT_FILES
+#define LOG_FAULT_FILES				4
+#endif
+#ifndef LOG_FAULT_FILE_SIZE
+#define LOG_FAULT_FILE_SIZE			4096
+#endif
+#ifndef LOG_TELEMETRY_FILES
+#define LOG_TELEMETRY_FILES			4
+#endif
+#ifndef LOG_TELEMETRY_FILE_SIZE
+#define LOG_TELEMETRY_FILE_SIZE		4096
+#endif
+#ifndef LOG_DEBUG_FILES
+#define LOG_DEBUG_FILES				2
+#endif
+#ifndef LOG_DEBUG_FILE_SIZE
+#define LOG_DEBUG_FILE_SIZE			4096
+#endif
+#ifndef LOG_CH_STAGE_SIZE
+#define LOG_CH_STAGE_SIZE			128    /*扩展通道的RAM暂存区大小*/
+#endif
+#endif
+
+/*-------------------- 常驻写入 --------------------*/
+#ifndef ROTATION_STAGE_SIZE
+#define ROTATION_STAGE_SIZE    		256    /*RAM暂存区大小，写满后统一写入文件*/
+#endif
+#ifndef ROTATION_FLUSH_MS
+#define ROTATION_FLUSH_MS      		1000   /*暂存数据最长停留时间(ms)，超时后刷入Flash*/
+#endif
 
 typedef struct {
     uint16_t newest_file_id;        
@@ -39,8 +115,76 @@ typedef struct {
     uint16_t active_file_count;     
     uint32_t current_file_offset;   
     uint32_t total_writes;          
+    uint32_t newest_seq;            /*最新文件的序号，每次轮转加1，供读取游标判断文件是否已被删除*/
 } rotation_state_t;
 
+/*日志读取游标，从最旧的记录开始按顺序跨文件读取，可在多次调用间保持位置*/
+typedef struct {
+    uint32_t seq;                   /*当前所在文件的序号*/
+    uint32_t offset;                /*当前文件内的偏移*/
+    uint32_t lost_files;            /*读取过程中被轮转删除而未读到的文件数*/
+} lfs_log_cursor_t;
+
+/*-------------------- 记录迭代 --------------------*/
+#ifndef LOG_ITER_CHUNK_SIZE
+#define LOG_ITER_CHUNK_SIZE			256    /*迭代器每次从文件读取的块大小*/
+#endif
+#define LOG_ITER_FILE_CACHE			64     /*迭代器的文件缓存，不小于各文件系统的cache_size*/
+
+#define LOG_ITER_TRUNCATED			0x01   /*记录超过缓冲区，只保存了开头部分*/
+#define LOG_ITER_INCOMPLETE			0x02   /*最新文件末尾不完整的记录(掉电)*/
+
+/*记录迭代器，按块读取文件并逐条取出记录，打印和导出共用。
+  当前文件在遍历期间保持打开，提前结束遍历时要调用lfs_log_iter_close*/
+typedef struct {
+    lfs_log_cursor_t cur;           /*下一次读入块缓冲的位置*/
+    uint8_t  type;                  /*日志通道LOG_CH_xxx*/
+    uint8_t  one_file;              /*1:只遍历一个文件*/
+    uint16_t chunk_len;             /*块缓冲中的数据长度*/
+    uint16_t chunk_pos;             /*块缓冲中下一个未处理字节*/
+    uint16_t index;                 /*当前文件中已取出的记录数*/
+    uint32_t skipped;               /*重新同步时跳过的字节数*/
+    uint32_t file_seq;              /*打开的文件的序号*/
+    uint8_t  file_buffer[LOG_ITER_FILE_CACHE];
+    uint8_t  chunk[LOG_ITER_CHUNK_SIZE];
+    lfs_file_t file;
+    struct lfs_file_config fcfg;    /*文件打开期间lfs会引用该配置*/
+    uint8_t  file_open;             /*file是否打开*/
+    uint8_t  file_live;             /*打开时是最新文件，读到末尾要重新打开才能读到新写入的数据*/
+} lfs_log_iter_t;
+
+/*迭代器取出的一条记录*/
+typedef struct {
+    uint32_t seq;                   /*所在文件的序号*/
+    uint16_t file_id;               /*所在文件的ID*/
+    uint16_t index;                 /*文件中的第几条，从0开始*/
+    uint32_t offset;                /*记录在文件中的偏移*/
+    uint32_t ts_ms;                 /*时间戳，仅帧格式有效*/
+    uint16_t len;                   /*记录内容原始长度*/
+    uint16_t stored;                /*实际保存到缓冲区的长度*/
+    uint8_t  type;                  /*记录类型LOG_REC_xxx，文本格式固定为LOG_REC_TEXT*/
+    uint8_t  flags;                 /*LOG_ITER_xxx*/
+    uint16_t crc;                   /*帧头中的CRC，仅帧格式有效*/
+} lfs_log_rec_t;
+
+/*-------------------- 记录帧格式 --------------------*/
+/*1:轮转文件中每条记录带帧头(长度/时间戳/类型/CRC)，0:兼容旧格式，以'/'结尾的文本*/
+#ifndef LOG_RECORD_FRAMED
+#define LOG_RECORD_FRAMED			0
+#endif
+
+/*帧头固定10字节，小端：sync(1) type(1) len(2) ts_ms(4) crc16(2)，crc覆盖帧头前8字节和负载*/
+#define LOG_REC_SYNC				0xA5
+#define LOG_REC_HDR_SIZE			10
+#define LOG_REC_MAX_PAYLOAD			(MAX_FILE_SIZE - LOG_REC_HDR_SIZE)
+
+/*记录类型*/
+#define LOG_REC_TEXT				0x01 /*hal_logNVM格式化文本*/
+#define LOG_REC_BIN					0x02 /*hal_logNVM_bin原始数据*/
+#define LOG_REC_FMT					0x03 /*延迟格式化：格式串ID(4字节)+原始参数*/
+#define LOG_REC_ERRCODE				0x04 /*错误码批量记录：条数(1)+首条时间戳(4)+每条src(1)/flags(1)/fault(2)/时间增量(变长)，flags含严重等级和GAP标志*/
+#define LOG_REC_ERRCOAL				0x05 /*合并模式错误码批量记录：在LOG_REC_ERRCODE每条之后加次数(变长)和最后出现时间增量(变长)*/
+
 /*-------------------- 参数键值对 --------------------*/
 /*存储参数键值对的文件名*/ 
 #define PARAM_FILENAME 			"param.txt"
@@ -79,8 +223,43 @@ int param_set(param_id_enum_t param_id, const void* value);
 param_value_t param_get_value(param_id_enum_t param_id);
 int lfs_store_log_outernal(const void *log_message, int message_len);
 int lfs_store_log_internal(const void *log_message, int message_len);
+int lfs_store_record(uint8_t type, uint8_t rec_type, uint32_t ts_ms, const void *data, int len);
 void log_lfs_init(void);
 void lfs_print_logs(uint8_t type);
+int lfs_log_flush(uint8_t type);
+void lfs_log_poll(void);
+int lfs_log_read(uint8_t type, void *logBuf, int maxBytesToRead);
 int lfs_log_inter_read(void *logBuf, int maxBytesToRead);
 int lfs_log_outer_read(void *logBuf, int maxBytesToRead);
+void lfs_log_read_rewind(uint8_t type);
+void lfs_log_cursor_open(uint8_t type, lfs_log_cursor_t *cur);
+int lfs_log_cursor_read(uint8_t type, lfs_log_cursor_t *cur, void *buf, int len);
+int lfs_log_cursor_read_records(uint8_t type, lfs_log_cursor_t *cur, void *buf, int len);
+void lfs_log_iter_open(uint8_t type, lfs_log_iter_t *it, int file_id);
+int lfs_log_iter_next(lfs_log_iter_t *it, lfs_log_rec_t *rec, void *buf, int size);
+void lfs_log_iter_close(lfs_log_iter_t *it);
+#if LFS_PORT_USE_EMU
+/*预测耗时统计的操作类型*/
+typedef enum {
+    LFS_LAT_ROTATION_WRITE = 0,
+    LFS_LAT_PARAM_SET,
+    LFS_LAT_MOUNT,
+    LFS_LAT_NUM
+} lfs_lat_op_t;
+
+/*按时序模型预测的片上耗时统计(us)*/
+typedef struct {
+    uint32_t count;      /*操作次数*/
+    uint32_t last_us;    /*最近一次典型耗时*/
+    uint32_t max_us;     /*典型耗时最大值*/
+    uint32_t worst_us;   /*最坏耗时最大值(器件最大时序)*/
+    uint64_t total_us;   /*典型耗时累计*/
+    uint32_t spikes;     /*期间发生擦除的次数*/
+} lfs_latency_t;
+
+lfs_emu_t *lfs_port_emu(uint8_t type);
+const lfs_latency_t *lfs_port_latency(lfs_lat_op_t op);
+void lfs_port_print_latency(void);
+void lfs_port_bench_log_read(uint8_t type);
+#endif
 #endif
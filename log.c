@@ -7,6 +7,8 @@
 #include "stdbool.h"
 #include "lfs.h"
 #include "errcode_fifo.h"
+#include "hal_rng.h"
+#include "critical.h"
 
 
 int   	param_A = 1;
@@ -27,6 +29,173 @@ param_entry_t param_table[MAX_PARAMS] = {
 };
 
 
+#if LOG_ASYNC
+/*异步队列中每条记录的头：flash(1) rec_type(1) len(2) ts_ms(4)*/
+#define LOG_ASYNC_HDR_SIZE		8
+
+#if (LOG_ASYNC_MAX_RECORD + LOG_ASYNC_HDR_SIZE) >= LOG_ASYNC_QUEUE_SIZE
+#error "LOG_ASYNC_QUEUE_SIZE must hold at least one LOG_ASYNC_MAX_RECORD record"
+#endif
+
+static char s_log_queue_buf[LOG_ASYNC_QUEUE_SIZE];
+static T_Ring s_log_queue_ring;
+static RING_ID s_log_queue = 0;
+static LOG_ASYNC_STATS s_log_async_stats;
+
+/*
+***************************************************************************************
+* 函 数 名: log_queue_drop_oldest
+* 功能说明: 丢弃队列中最旧的一条记录，需在临界区内调用
+* 形   参: 无
+* 返 回 值: 无
+***************************************************************************************
+*/
+static void log_queue_drop_oldest(void)
+{
+	uint8_t hdr[LOG_ASYNC_HDR_SIZE];
+
+	if (rngBufGet(s_log_queue, (char *)hdr, LOG_ASYNC_HDR_SIZE) != LOG_ASYNC_HDR_SIZE)
+	{
+		rngClear(s_log_queue);
+		return;
+	}
+	/*负载不需要读出，直接跳过*/
+	rngConsume(s_log_queue, hdr[2] | (hdr[3] << 8));
+	s_log_async_stats.overwritten++;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: log_submit
+* 功能说明: 日志前端：异步模式下把记录拷贝进RAM队列后立即返回，由hal_log_drain写入Flash；
+*          同步模式下直接写入
+* 形   参: type - 选择要操作的Flash；rec_type - 记录类型；data - 负载；len - 负载长度
+* 返 回 值: 正数:入队/写入的字节数，-1:丢弃或失败
+***************************************************************************************
+*/
+static int log_submit(FLASH_TYPE type, uint8_t rec_type, const void *data, int len)
+{
+	uint8_t hdr[LOG_ASYNC_HDR_SIZE];
+	uint32_t ts = g_systick_ms;
+	int need = LOG_ASYNC_HDR_SIZE + len;
+
+	if (len <= 0 || len > LOG_ASYNC_MAX_RECORD)
+	{
+		/*中断和主循环都会调用，计数也在临界区内修改*/
+		u32 pm = Critical_Enter();
+		s_log_async_stats.dropped++;
+		Critical_Exit(pm);
+		return -1;
+	}
+
+	hdr[0] = (uint8_t)type;
+	hdr[1] = rec_type;
+	hdr[2] = (uint8_t)len;
+	hdr[3] = (uint8_t)(len >> 8);
+	hdr[4] = (uint8_t)ts;
+	hdr[5] = (uint8_t)(ts >> 8);
+	hdr[6] = (uint8_t)(ts >> 16);
+	hdr[7] = (uint8_t)(ts >> 24);
+
+	u32 pm = Critical_Enter();
+	if (s_log_queue == 0)
+	{
+		s_log_queue = rngInit(&s_log_queue_ring, s_log_queue_buf, LOG_ASYNC_QUEUE_SIZE);
+	}
+	/*ring最多存放capaticy-1个字节*/
+	while (LOG_ASYNC_QUEUE_SIZE - 1 - rngLen(s_log_queue) < need)
+	{
+#if LOG_ASYNC_POLICY == LOG_ASYNC_DROP_OLD
+		if (rngIsEmpty(s_log_queue))
+		{
+			break;
+		}
+		log_queue_drop_oldest();
+#else
+		s_log_async_stats.dropped++;
+		Critical_Exit(pm);
+		return -1;
+#endif
+	}
+	rngBufPut(s_log_queue, (char *)hdr, LOG_ASYNC_HDR_SIZE);
+	rngBufPut(s_log_queue, (char *)data, len);
+	s_log_async_stats.enqueued++;
+	int used = rngLen(s_log_queue);
+	if (used > s_log_async_stats.high_water)
+	{
+		s_log_async_stats.high_water = used;
+	}
+	Critical_Exit(pm);
+	return len;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: hal_log_drain
+* 功能说明: 日志后台：从RAM队列取出记录写入文件系统，在主循环或低优先级任务中调用。
+*          出队在临界区内完成，写Flash在临界区外完成
+* 形   参: max_records - 本次最多处理的记录数，<=0表示处理到队列为空
+* 返 回 值: 本次写入的记录数
+***************************************************************************************
+*/
+int hal_log_drain(int max_records)
+{
+	static uint8_t payload[LOG_ASYNC_MAX_RECORD];
+	uint8_t hdr[LOG_ASYNC_HDR_SIZE];
+	int count = 0;
+
+	while (max_records <= 0 || count < max_records)
+	{
+		u32 pm = Critical_Enter();
+		if (s_log_queue == 0 || rngLen(s_log_queue) < LOG_ASYNC_HDR_SIZE)
+		{
+			Critical_Exit(pm);
+			break;
+		}
+		rngBufGet(s_log_queue, (char *)hdr, LOG_ASYNC_HDR_SIZE);
+		int len = hdr[2] | (hdr[3] << 8);
+		int got = rngBufGet(s_log_queue, (char *)payload, len);
+		Critical_Exit(pm);
+
+		if (got != len)
+		{
+			break;
+		}
+		uint32_t ts = (uint32_t)hdr[4] | ((uint32_t)hdr[5] << 8) | ((uint32_t)hdr[6] << 16) | ((uint32_t)hdr[7] << 24);
+		if (lfs_store_record(hdr[0], hdr[1], ts, payload, len) < 0)
+		{
+			s_log_async_stats.write_failed++;
+		}
+		else
+		{
+			s_log_async_stats.written++;
+		}
+		count++;
+	}
+	return count;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: hal_log_async_stats
+* 功能说明: 获取异步日志队列的统计计数
+* 形   参: out - 输出统计
+* 返 回 值: 无
+***************************************************************************************
+*/
+void hal_log_async_stats(LOG_ASYNC_STATS *out)
+{
+	u32 pm = Critical_Enter();
+	*out = s_log_async_stats;
+	Critical_Exit(pm);
+}
+#else
+static int log_submit(FLASH_TYPE type, uint8_t rec_type, const void *data, int len)
+{
+	return lfs_store_record(type, rec_type, g_systick_ms, data, len);
+}
+#endif
+
 /*
 ***************************************************************************************
 * 函 数 名: hal_logNVM
@@ -45,10 +214,12 @@ int hal_logNVM(FLASH_TYPE type,const char * format, ...)
     char log_buf[LOG_BUFF_SIZE];
     int written_len;
     va_list args;
+#if !LOG_RECORD_FRAMED
     bool needs_newline = true;
+#endif
     
 	choose_type = type;
-	if(choose_type != INTER_FLASH && choose_type != OUTER_FLASH)
+	if((unsigned)choose_type >= LOG_CHANNEL_NUM)
 	{
 		always_Print(0,("Invalid Flash type!\n"));
 		return -1;
@@ -68,7 +239,8 @@ int hal_logNVM(FLASH_TYPE type,const char * format, ...)
         written_len = sizeof(log_buf) - 1;
     }
 
-    /*检查是否需要添加换行符*/  
+#if !LOG_RECORD_FRAMED
+    /*检查是否需要添加换行符，帧格式下由帧头给出长度，不需要结束符*/  
     if (written_len > 0) 
 	{
         /*检查最后是否已经是结束符*/ 
@@ -84,15 +256,11 @@ int hal_logNVM(FLASH_TYPE type,const char * format, ...)
 			written_len+=1;     
         }
     }
+#endif
     
-	
-	if(choose_type == INTER_FLASH)
-	{    
-		lfs_store_log_internal(log_buf,written_len);
-	}
-	if(choose_type == OUTER_FLASH)
+	if (log_submit(choose_type, LOG_REC_TEXT, log_buf, written_len) < 0)
 	{
-		lfs_store_log_outernal(log_buf,written_len);
+		return -1;
 	}
 
     return written_len;
@@ -101,7 +269,8 @@ int hal_logNVM(FLASH_TYPE type,const char * format, ...)
 /*
 ***************************************************************************************
 * 函 数 名: hal_logNVM_bin
-* 功能说明: 写入原始二进制数据到FLASH中（不做格式化）
+* 功能说明: 写入原始二进制数据到FLASH中（不做格式化），开启LOG_RECORD_FRAMED后
+*          数据中可以包含'/'而不会破坏记录边界
 * 形   参: type - 选择要操作的Flash，内部还是外部
 *          data - 数据指针
 *          len  - 数据长度
@@ -115,13 +284,9 @@ int hal_logNVM_bin(FLASH_TYPE type,const void * data, int len)
 		return LOG_BUFF_ERR;
 	}
 
-	if (type == INTER_FLASH)
+	if ((unsigned)type < LOG_CHANNEL_NUM)
 	{
-		return lfs_store_log_internal(data, len);
-	}
-	else if (type == OUTER_FLASH)
-	{
-		return lfs_store_log_outernal(data, len);
+		return log_submit(type, LOG_REC_BIN, data, len);
 	}
 	else
 	{
@@ -131,34 +296,178 @@ int hal_logNVM_bin(FLASH_TYPE type,const void * data, int len)
 
 
 
+#if LOG_DEFERRED_FMT
+/*
+***************************************************************************************
+* 函 数 名: log_fmt_put
+* 功能说明: 以小端方式把参数追加到延迟格式化记录中
+* 形   参: rec - 记录缓冲区；pos - 当前写入位置；val - 参数值；size - 字节数(4或8)
+* 返 回 值: 新的写入位置，空间不足返回-1
+***************************************************************************************
+*/
+static int log_fmt_put(uint8_t *rec, int pos, uint64_t val, int size)
+{
+	if (pos < 0 || pos + size > LOG_FMT_MAX_PAYLOAD)
+	{
+		return -1;
+	}
+	for (int i = 0; i < size; i++)
+	{
+		rec[pos++] = (uint8_t)(val >> (8 * i));
+	}
+	return pos;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: hal_logNVM_fmt
+* 功能说明: 延迟格式化写日志，只保存格式串ID和原始参数，不调用vsnprintf。
+*          一般通过LOGNVM宏调用，格式串需位于.logfmt段。
+*          参数编码：整数/字符/指针4字节，%ll与浮点8字节，%s为1字节长度+最多LOG_FMT_STR_MAX个字符
+* 形   参: type - 选择要操作的Flash，内部还是外部
+*		  fmt  - 格式串(.logfmt段中的常量)
+* 返 回 值: -1:写入失败
+*		  正数:记录负载的字节长度
+***************************************************************************************
+*/
+int hal_logNVM_fmt(FLASH_TYPE type,const char * fmt, ...)
+{
+	uint8_t rec[LOG_FMT_MAX_PAYLOAD];
+	int pos = 0;
+	int end;    /*最后一个完整编码的参数之后的位置*/
+	va_list args;
+	const char *p = fmt;
+
+	if((unsigned)type >= LOG_CHANNEL_NUM)
+	{
+		return -1;
+	}
+
+	pos = log_fmt_put(rec, pos, (uint32_t)(uintptr_t)fmt, 4);
+	end = pos;
+
+	va_start(args, fmt);
+	while (pos >= 0 && (p = strchr(p, '%')) != NULL)
+	{
+		int longs = 0;
+		p++;
+		if (*p == '%')
+		{
+			p++;
+			continue;
+		}
+		/*跳过标志、宽度、精度，'*'会消耗一个int参数*/
+		while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {p++;}
+		if (*p == '*') {pos = log_fmt_put(rec, pos, (uint32_t)va_arg(args, int), 4); p++;}
+		while (*p >= '0' && *p <= '9') {p++;}
+		if (*p == '.')
+		{
+			p++;
+			if (*p == '*') {pos = log_fmt_put(rec, pos, (uint32_t)va_arg(args, int), 4); p++;}
+			while (*p >= '0' && *p <= '9') {p++;}
+		}
+		while (*p == 'l' || *p == 'h' || *p == 'z' || *p == 'j' || *p == 't')
+		{
+			if (*p == 'l') {longs++;}
+			p++;
+		}
+
+		switch (*p)
+		{
+			case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+				if (longs >= 2)
+				{
+					pos = log_fmt_put(rec, pos, (uint64_t)va_arg(args, long long), 8);
+				}
+				else
+				{
+					pos = log_fmt_put(rec, pos, (uint32_t)va_arg(args, int), 4);
+				}
+				break;
+			case 'p':
+				pos = log_fmt_put(rec, pos, (uint32_t)(uintptr_t)va_arg(args, void *), 4);
+				break;
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+			{
+				double d = va_arg(args, double);
+				uint64_t bits;
+				memcpy(&bits, &d, sizeof(bits));
+				pos = log_fmt_put(rec, pos, bits, 8);
+				break;
+			}
+			case 's':
+			{
+				const char *str = va_arg(args, const char *);
+				int len = 0;
+				while (str != NULL && len < LOG_FMT_STR_MAX && str[len] != '\0') {len++;}
+				pos = log_fmt_put(rec, pos, (uint32_t)len, 1);
+				if (pos >= 0 && pos + len <= LOG_FMT_MAX_PAYLOAD)
+				{
+					memcpy(&rec[pos], str, len);
+					pos += len;
+				}
+				else
+				{
+					pos = -1;
+				}
+				break;
+			}
+			default:
+				break;
+		}
+		if (*p != '\0') {p++;}
+		if (pos >= 0)
+		{
+			end = pos;
+		}
+	}
+	va_end(args);
+
+	/*参数区放不下时只写入已完整编码的参数，主机端解码时缺失的参数显示为'?'*/
+	return log_submit(type, LOG_REC_FMT, rec, end);
+}
+#endif
+
+
 /*
 ***************************************************************************************
 *    函 数 名: hal_logNVM_Read
-*    功能说明: 从非易失存储器区读取日志内容
+*    功能说明: 从非易失存储器区增量读取日志内容，第一次从最旧的日志开始，
+*			 之后从上次读取结束处继续，跨轮转文件连续读取
 *    形   参: type - 选择要操作的Flash，内部还是外部
 *			 logBuf - 字符串缓存
-*  			 offset - 读取起始偏移，单位字节
 *			 maxBytesToRead - 可以返回日志内容的字节长度最大值
 *    返 回 值: n - 返回读到的字节数
-*			 0 - 读取失败
+*			 0 - 已读到最新的日志
 ***************************************************************************************
 */
 int hal_logNVM_Read(FLASH_TYPE type,void * logBuf, int maxBytesToRead)
 {
-	#define LOG_READ_ADDR	(LOG_DATA_ADDR)
 	if(logBuf == NULL || maxBytesToRead <= 0) 
 	{
         return LOG_BUFF_ERR; 
     }
-	if(type == INTER_FLASH)
+#if LOG_ASYNC
+	hal_log_drain(0);
+#endif
+	if((unsigned)type >= LOG_CHANNEL_NUM)
 	{
-		return lfs_log_inter_read(logBuf, maxBytesToRead);
+		return LOG_BUFF_ERR;
 	}
-	if(type == OUTER_FLASH)
-	{
-		return lfs_log_outer_read(logBuf, maxBytesToRead);
-	}	
-	
+	return lfs_log_read((uint8_t)type, logBuf, maxBytesToRead);
+}
+
+/*
+***************************************************************************************
+*    函 数 名: hal_logNVM_ReadRewind
+*    功能说明: 让hal_logNVM_Read重新从最旧的日志开始读取
+*    形   参: type - 选择要操作的Flash，内部还是外部
+*    返 回 值: 无
+***************************************************************************************
+*/
+void hal_logNVM_ReadRewind(FLASH_TYPE type)
+{
+	lfs_log_read_rewind((uint8_t)type);
 }
 
 /*
@@ -171,10 +480,47 @@ int hal_logNVM_Read(FLASH_TYPE type,void * logBuf, int maxBytesToRead)
 */
 void hal_log_print(FLASH_TYPE type)
 {
+#if LOG_ASYNC
+	hal_log_drain(0);
+#endif
 	lfs_print_logs(type);
 }
 
 
+/*
+***************************************************************************************
+*    函 数 名: hal_log_flush
+*    功能说明: 将暂存区中的日志立即写入Flash，掉电前或需要确保落盘时调用
+*    形   参: type - 选择要操作的Flash，内部还是外部
+*    返 回 值: 0成功，-1失败
+***************************************************************************************
+*/
+int hal_log_flush(FLASH_TYPE type)
+{
+#if LOG_ASYNC
+	hal_log_drain(0);
+#endif
+	return lfs_log_flush(type);
+}
+
+/*
+***************************************************************************************
+*    函 数 名: hal_log_poll
+*    功能说明: 日志后台处理，在主循环中周期调用，异步模式下先处理队列中的记录，
+*             超时未刷新的暂存日志会被写入Flash
+*    形   参: 无
+*    返 回 值: 无
+***************************************************************************************
+*/
+void hal_log_poll(void)
+{
+#if LOG_ASYNC
+	hal_log_drain(LOG_ASYNC_DRAIN_MAX);
+#endif
+	lfs_log_poll();
+}
+
+
 /*
 ***************************************************************************************
 *    函 数 名: hal_log_clean
@@ -284,7 +630,6 @@ int hal_statNVM_write(param_id_enum_t id,const void *value)
 void lfs_RW_test(void)
 {
 	static uint8_t key_down_num = 0;
-	char log_buffer[128];
 	static int end = 0;
 	static int start_time,end_time = 0;
 	if (g.user_key_button.clicked == ON) 
@@ -298,8 +643,7 @@ void lfs_RW_test(void)
 		start_time = g_systick_ms;
 		for(int i=end-50;i<end;i++)
 		{
-			sprintf(log_buffer, "this is #%4d write, hello world", i);
-			hal_logNVM(OUTER_FLASH,log_buffer);
+			LOGNVM(OUTER_FLASH, "this is #%4d write, hello world", i);
 		}
 		end_time = g_systick_ms;
 		//always_Print(0, ("after write file size = %d\r\n",get_file_size(LOG_FILENAME)));
@@ -332,24 +676,125 @@ void lfs_RW_test(void)
 	}
 }
 
+#if LOG_RECORD_FRAMED && ERRFIFO_COALESCE
+#define ERR_CODE_REC_TYPE		LOG_REC_ERRCOAL
+#define ERR_CODE_REC_SIZE		(5 + ERR_CODE_BATCH_MAX * 17) 	/*再加3字节次数+5字节最后出现时间增量*/
+#elif LOG_RECORD_FRAMED
+#define ERR_CODE_REC_TYPE		LOG_REC_ERRCODE
+#define ERR_CODE_REC_SIZE		(5 + ERR_CODE_BATCH_MAX * 9) 	/*每条最多4字节+5字节变长时间增量*/
+#elif ERRFIFO_COALESCE
+#define ERR_CODE_REC_TYPE		LOG_REC_TEXT
+#define ERR_CODE_REC_SIZE		(ERR_CODE_BATCH_MAX * 40 + 1) 	/*每条最多"255-4294967295-ffff:ff*65535+4294967295;"*/
+#else
+#define ERR_CODE_REC_TYPE		LOG_REC_TEXT
+#define ERR_CODE_REC_SIZE		(ERR_CODE_BATCH_MAX * 23 + 1) 	/*每条最多"255-4294967295-ffff:ff;"*/
+#endif
+
+#if LOG_ASYNC && (ERR_CODE_REC_SIZE > LOG_ASYNC_MAX_RECORD)
+#error "ERR_CODE_BATCH_MAX too large for LOG_ASYNC_MAX_RECORD"
+#endif
+
+/*
+***************************************************************************************
+* 函 数 名: err_code_put_var
+* 功能说明: 以LEB128变长格式追加一个无符号数，每字节7位，最高位表示后面还有字节
+* 形   参: rec - 记录缓冲区；pos - 当前写入位置；val - 数值
+* 返 回 值: 新的写入位置
+***************************************************************************************
+*/
+static int err_code_put_var(uint8_t *rec, int pos, uint32_t val)
+{
+	while (val >= 0x80U)
+	{
+		rec[pos++] = (uint8_t)(val | 0x80U);
+		val >>= 7;
+	}
+	rec[pos++] = (uint8_t)val;
+	return pos;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: err_code_encode
+* 功能说明: 把一批错误码编码成一条记录。帧格式下为LOG_REC_ERRCODE二进制记录：
+*          条数(1) 首条时间戳(4)，之后每条为src(1) flags(1) fault(2) 与上一条的时间增量(LEB128)，小端，
+*          flags为ERRFIFO_FLAG_xxx和严重等级；
+*          合并模式下为LOG_REC_ERRCOAL，每条再加次数(LEB128)和最后出现时间相对首次的增量(LEB128)。
+*          文本格式下为以';'分隔、'/'结尾的"src-ts-fault:flags"，合并模式为"src-ts-fault:flags*次数+增量"，
+*          fault和flags为十六进制
+* 形   参: items - 错误码；n - 条数；rec - 记录缓冲区，大小为ERR_CODE_REC_SIZE
+* 返 回 值: 记录长度
+***************************************************************************************
+*/
+static int err_code_encode(const ErrCodeFifoItem_t *items, int n, uint8_t *rec)
+{
+	int pos = 0;
+	uint32_t prev = (uint32_t)items[0].ts_ms;
+
+#if LOG_RECORD_FRAMED
+	rec[pos++] = (uint8_t)n;
+	rec[pos++] = (uint8_t)prev;
+	rec[pos++] = (uint8_t)(prev >> 8);
+	rec[pos++] = (uint8_t)(prev >> 16);
+	rec[pos++] = (uint8_t)(prev >> 24);
+	for (int i = 0; i < n; i++)
+	{
+		uint32_t dt = (uint32_t)items[i].ts_ms - prev;
+		prev = (uint32_t)items[i].ts_ms;
+		rec[pos++] = items[i].src;
+		rec[pos++] = items[i].flags;
+		rec[pos++] = (uint8_t)items[i].fault;
+		rec[pos++] = (uint8_t)(items[i].fault >> 8);
+		pos = err_code_put_var(rec, pos, dt);
+#if ERRFIFO_COALESCE
+		pos = err_code_put_var(rec, pos, items[i].count);
+		pos = err_code_put_var(rec, pos, items[i].last_ts_ms - (uint32_t)items[i].ts_ms);
+#endif
+	}
+#else
+	(void)prev;
+	for (int i = 0; i < n; i++)
+	{
+#if ERRFIFO_COALESCE
+		pos += snprintf((char *)&rec[pos], ERR_CODE_REC_SIZE - pos, "%d-%lu-%x:%x*%u+%lu%c", items[i].src,
+		                (unsigned long)(uint32_t)items[i].ts_ms, items[i].fault, items[i].flags, items[i].count,
+		                (unsigned long)(items[i].last_ts_ms - (uint32_t)items[i].ts_ms), (i == n - 1) ? '/' : ';');
+#else
+		pos += snprintf((char *)&rec[pos], ERR_CODE_REC_SIZE - pos, "%d-%lu-%x:%x%c", items[i].src,
+		                (unsigned long)(uint32_t)items[i].ts_ms, items[i].fault, items[i].flags, (i == n - 1) ? '/' : ';');
+#endif
+	}
+#endif
+	return pos;
+}
+
 /*
 ***************************************************************************************
 * 函 数 名: hal_err_code_store
-* 功能说明: 将错误码FIFO中的原始记录逐条写入log
+* 功能说明: 在一次临界区内从错误码FIFO取出一批记录，合并编码后只写一次Flash。
+*          不在这里打印日志，故障集中爆发时每批只有一次写入
 * 形   参: 无
-* 返 回 值: 无
+* 返 回 值: 本次取出的错误码条数，写入失败返回-1(取出的错误码已丢失)
 ***************************************************************************************
 */
-void hal_err_code_store(void)
+int hal_err_code_store(void)
 {
-	ErrCodeFifoItem_t rec;
+	static ErrCodeFifoItem_t items[ERR_CODE_BATCH_MAX];
+	static uint8_t rec[ERR_CODE_REC_SIZE];
 
-	if(ErrCodeFIFO_Pop(&rec))
+	int n = ErrCodeFIFO_PopBatch(items, ERR_CODE_BATCH_MAX);
+	if (n == 0)
 	{
-		hal_logNVM(OUTER_FLASH,"%d-%llu-%x", rec.src,rec.ts_ms,rec.fault);
-		hal_log_print(OUTER_FLASH);
+		return 0;
+	}
+
+	int len = err_code_encode(items, n, rec);
+	if (log_submit(ERR_CODE_LOG_CHANNEL, ERR_CODE_REC_TYPE, rec, len) < 0)
+	{
+		return -1;
 	}
-}     
+	return n;
+}
 
 /*
 ***************************************************************************************
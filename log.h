@@ -21,12 +21,90 @@
 
 typedef enum
 {
-	INTER_FLASH, /*选择内部Flash保存日志*/
-	OUTER_FLASH  /*选择外部Flash（GD25Q80）保存日志*/
+	INTER_FLASH = LOG_CH_INTER, /*选择内部Flash保存日志*/
+	OUTER_FLASH = LOG_CH_OUTER, /*选择外部Flash（GD25Q80）保存日志*/
+#if LOG_EXTRA_CHANNELS
+	FAULT_CHANNEL = LOG_CH_FAULT,         /*外部Flash故障记录通道*/
+	TELEMETRY_CHANNEL = LOG_CH_TELEMETRY, /*外部Flash遥测通道*/
+	DEBUG_CHANNEL = LOG_CH_DEBUG,         /*外部Flash调试通道*/
+#endif
 }FLASH_TYPE;
 
 
 
+/*-------------------- 错误码批量存储 --------------------*/
+#ifndef ERR_CODE_BATCH_MAX
+#define ERR_CODE_BATCH_MAX		11 	/*hal_err_code_store每次最多取出并合并为一条记录的错误码条数，文本格式最长254字节*/
+#endif
+#ifndef ERR_CODE_LOG_CHANNEL
+#if LOG_EXTRA_CHANNELS
+#define ERR_CODE_LOG_CHANNEL	FAULT_CHANNEL
+#else
+#define ERR_CODE_LOG_CHANNEL	OUTER_FLASH
+#endif
+#endif
+
+
+
+/*-------------------- 延迟格式化 --------------------*/
+/*1:LOGNVM只记录格式串ID和原始参数，由主机端工具(tools/log_dict.py)还原文本；0:在调用处格式化*/
+#ifndef LOG_DEFERRED_FMT
+#define LOG_DEFERRED_FMT		0
+#endif
+
+#if LOG_DEFERRED_FMT
+#if !LOG_RECORD_FRAMED
+#error "LOG_DEFERRED_FMT requires LOG_RECORD_FRAMED"
+#endif
+#define LOG_FMT_SECTION			__attribute__((section(".logfmt"), used))
+#define LOG_FMT_MAX_PAYLOAD		64 	/*单条记录参数区最大字节数(含4字节格式串ID)*/
+#define LOG_FMT_STR_MAX			32 	/*%s参数最多保存的字符数*/
+
+/*格式串必须是字符串常量，放入.logfmt段，段内地址即格式串ID*/
+#define LOGNVM(type, fmt, ...)	do { \
+									static const char log_fmt_str[] LOG_FMT_SECTION = fmt; \
+									hal_logNVM_fmt((type), log_fmt_str, ##__VA_ARGS__); \
+								} while (0)
+#else
+#define LOGNVM(type, fmt, ...)	hal_logNVM((type), fmt, ##__VA_ARGS__)
+#endif
+
+
+
+/*-------------------- 异步日志 --------------------*/
+/*1:hal_logNVM只把记录拷贝进RAM队列，由hal_log_drain/hal_log_poll在后台写入Flash*/
+#ifndef LOG_ASYNC
+#define LOG_ASYNC				0
+#endif
+
+#define LOG_ASYNC_DROP_NEW		0 	/*队列满时丢弃新记录*/
+#define LOG_ASYNC_DROP_OLD		1 	/*队列满时覆盖最旧的记录*/
+
+#ifndef LOG_ASYNC_POLICY
+#define LOG_ASYNC_POLICY		LOG_ASYNC_DROP_NEW
+#endif
+#ifndef LOG_ASYNC_QUEUE_SIZE
+#define LOG_ASYNC_QUEUE_SIZE	2048 	/*队列大小(字节)*/
+#endif
+#ifndef LOG_ASYNC_MAX_RECORD
+#define LOG_ASYNC_MAX_RECORD	256 	/*单条记录最大负载*/
+#endif
+#ifndef LOG_ASYNC_DRAIN_MAX
+#define LOG_ASYNC_DRAIN_MAX		16 	/*hal_log_poll每次最多写入的记录数*/
+#endif
+
+/*异步队列统计*/
+typedef struct
+{
+	uint32_t enqueued;      /*入队记录数*/
+	uint32_t written;       /*已写入文件系统的记录数*/
+	uint32_t dropped;       /*队列满或超长被丢弃的新记录数*/
+	uint32_t overwritten;   /*被覆盖的旧记录数*/
+	uint32_t write_failed;  /*写入文件系统失败的记录数*/
+	int      high_water;    /*队列最大占用(字节)*/
+}LOG_ASYNC_STATS;
+
+
 typedef enum
 {
 	LOG_READ_ERR,
@@ -39,12 +117,22 @@ typedef enum
 void hal_log_init(void);
 int hal_logNVM(FLASH_TYPE type,const char * format, ...);
 int hal_logNVM_bin(FLASH_TYPE type,const void * data, int len);
+#if LOG_DEFERRED_FMT
+int hal_logNVM_fmt(FLASH_TYPE type,const char * fmt, ...);
+#endif
 int hal_logNVM_Read(FLASH_TYPE type,void * logBuf, int maxBytesToRead);
+void hal_logNVM_ReadRewind(FLASH_TYPE type);
 void hal_log_print(FLASH_TYPE type);
+int hal_log_flush(FLASH_TYPE type);
+void hal_log_poll(void);
+#if LOG_ASYNC
+int hal_log_drain(int max_records);
+void hal_log_async_stats(LOG_ASYNC_STATS *out);
+#endif
 param_value_t hal_statNVM_read(param_id_enum_t id);	
 //int API_statNVM_write(ID_LIST id,const char * format, ...);
 int hal_statNVM_write(param_id_enum_t id,const void *value);\
-void hal_err_code_store(void);
+int hal_err_code_store(void);
 #endif
 
 
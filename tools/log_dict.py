@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+延迟格式化日志的主机端工具
+
+  extract: 从固件ELF的.logfmt段提取格式串字典(地址 -> 格式串)，构建时执行
+      python3 log_dict.py extract firmware.axf -o logfmt.json
+  decode:  按字典解码从Flash导出的轮转日志文件(LOG_RECORD_FRAMED格式)
+      python3 log_dict.py decode logfmt.json log000.txt log001.txt ...
+
+记录帧格式与lfs_port.h一致：sync(1) type(1) len(2) ts_ms(4) crc16(2)，小端，
+LOG_REC_FMT负载为格式串ID(4字节)+参数，参数编码与log.c中hal_logNVM_fmt一致。
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+
+LOG_REC_SYNC = 0xA5
+LOG_REC_HDR_SIZE = 10
+LOG_REC_TEXT = 0x01
+LOG_REC_BIN = 0x02
+LOG_REC_FMT = 0x03
+LOG_REC_ERRCODE = 0x04
+LOG_REC_ERRCOAL = 0x05
+
+ERRFIFO_FLAG_GAP = 0x01
+ERRFIFO_FLAG_SEV_SHIFT = 4
+ERRFIFO_FLAG_SEV_MASK = 0x70
+ERRFIFO_SEV_NAMES = ("info", "warn", "error", "crit")
+
+FMT_SPEC = re.compile(r"%(?P<flags>[-+ #0]*)(?P<width>\*|\d+)?(?:\.(?P<prec>\*|\d+))?"
+                      r"(?P<len>hh|h|ll|l|z|j|t)?(?P<conv>[diouxXcpfFeEgGs%])")
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC16-CCITT，多项式0x1021，与log_rec_crc16一致"""
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def extract(elf_path):
+    """解析ELF节头，返回.logfmt段中 {地址: 格式串}"""
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF":
+        raise SystemExit("%s: not an ELF file" % elf_path)
+    is64 = elf[4] == 2
+    if is64:
+        shoff, = struct.unpack_from("<Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x3A)
+    else:
+        shoff, = struct.unpack_from("<I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+
+    def section(i):
+        base = shoff + i * shentsize
+        if is64:
+            name, _, _, addr, off, size = struct.unpack_from("<IIQQQQ", elf, base)
+        else:
+            name, _, _, addr, off, size = struct.unpack_from("<IIIIII", elf, base)
+        return name, addr, off, size
+
+    _, _, stroff, _ = section(shstrndx)
+    table = {}
+    for i in range(shnum):
+        name_off, addr, off, size = section(i)
+        end = elf.index(b"\0", stroff + name_off)
+        if elf[stroff + name_off:end] != b".logfmt":
+            continue
+        data = elf[off:off + size]
+        pos = 0
+        while pos < len(data):
+            nul = data.find(b"\0", pos)
+            if nul < 0:
+                nul = len(data)
+            if nul > pos:
+                table[addr + pos] = data[pos:nul].decode("utf-8", "replace")
+            pos = nul + 1
+    return table
+
+
+def render(fmt, payload):
+    """按格式串依次取出参数并还原文本，参数不足时以'?'代替"""
+    pos = [0]
+
+    def take(size, signed):
+        if pos[0] + size > len(payload):
+            return None
+        code = {4: "<i", 8: "<q"}[size] if signed else {4: "<I", 8: "<Q"}[size]
+        val, = struct.unpack_from(code, payload, pos[0])
+        pos[0] += size
+        return val
+
+    def repl(m):
+        conv = m.group("conv")
+        if conv == "%":
+            return "%"
+        spec = "%" + m.group("flags")
+        for part, prefix in (("width", ""), ("prec", ".")):
+            v = m.group(part)
+            if v == "*":
+                v = take(4, True)
+                if v is None:
+                    return "?"
+                v = str(v)
+            if v is not None:
+                spec += prefix + v
+        longs = (m.group("len") or "").count("l")
+        if conv in "di":
+            val = take(8 if longs >= 2 else 4, True)
+            spec += "d"
+        elif conv in "uxXoc":
+            val = take(8 if longs >= 2 else 4, False)
+            spec += "d" if conv == "u" else conv
+        elif conv == "p":
+            val = take(4, False)
+            spec = "0x%08x"
+        elif conv in "fFeEgG":
+            bits = take(8, False)
+            val = None if bits is None else struct.unpack("<d", struct.pack("<Q", bits))[0]
+            spec += conv.lower() if conv == "F" else conv
+        else:  # 's'
+            if pos[0] >= len(payload):
+                return "?"
+            n = payload[pos[0]]
+            val = payload[pos[0] + 1:pos[0] + 1 + n].decode("utf-8", "replace")
+            pos[0] += 1 + n
+            spec += "s"
+        if val is None:
+            return "?"
+        return spec % val
+
+    return FMT_SPEC.sub(repl, fmt)
+
+
+def render_errcode(payload, coalesced=False):
+    """LOG_REC_ERRCODE：条数(1)+首条时间戳(4)，每条src(1) flags(1) fault(2) 时间增量(LEB128)；
+    LOG_REC_ERRCOAL每条再加次数和最后出现时间增量(LEB128)，与log.c中err_code_encode一致。
+    flags显示为严重等级，GAP表示此条之前有同等级的错误码被淘汰"""
+    if len(payload) < 5:
+        return "<short errcode batch> " + payload.hex()
+    count, ts = struct.unpack_from("<BI", payload, 0)
+    pos = 5
+
+    def var():
+        nonlocal pos
+        val, shift = 0, 0
+        while pos < len(payload):
+            b = payload[pos]
+            pos += 1
+            val |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                break
+        return val
+
+    items = []
+    for _ in range(count):
+        if pos + 4 > len(payload):
+            items.append("?")
+            break
+        src, flags, fault = struct.unpack_from("<BBH", payload, pos)
+        pos += 4
+        ts = (ts + var()) & 0xFFFFFFFF
+        sev = (flags & ERRFIFO_FLAG_SEV_MASK) >> ERRFIFO_FLAG_SEV_SHIFT
+        tag = " " + (ERRFIFO_SEV_NAMES[sev] if sev < len(ERRFIFO_SEV_NAMES) else "sev%d" % sev)
+        if flags & ERRFIFO_FLAG_GAP:
+            tag += " GAP"
+        if coalesced:
+            hits = var()
+            last = (ts + var()) & 0xFFFFFFFF
+            items.append("%d-%u-%x%s x%d last@%u" % (src, ts, fault, tag, hits, last))
+        else:
+            items.append("%d-%u-%x%s" % (src, ts, fault, tag))
+    return "errcode x%d: %s" % (count, ";".join(items))
+
+
+def decode(table, path):
+    with open(path, "rb") as f:
+        data = f.read()
+    pos = 0
+    count = 0
+    while pos + LOG_REC_HDR_SIZE <= len(data):
+        sync, rtype, length, ts, crc = struct.unpack_from("<BBHIH", data, pos)
+        end = pos + LOG_REC_HDR_SIZE + length
+        if sync != LOG_REC_SYNC or length == 0 or end > len(data):
+            pos += 1
+            continue
+        payload = data[pos + LOG_REC_HDR_SIZE:end]
+        if crc16(payload, crc16(data[pos:pos + LOG_REC_HDR_SIZE - 2])) != crc:
+            pos += 1
+            continue
+        count += 1
+        if rtype == LOG_REC_TEXT:
+            text = payload.decode("utf-8", "replace")
+        elif rtype == LOG_REC_FMT and len(payload) >= 4:
+            fmt_id, = struct.unpack_from("<I", payload, 0)
+            fmt = table.get(fmt_id)
+            text = render(fmt, payload[4:]) if fmt is not None else \
+                "<unknown fmt 0x%08x> %s" % (fmt_id, payload[4:].hex())
+        elif rtype in (LOG_REC_ERRCODE, LOG_REC_ERRCOAL):
+            text = render_errcode(payload, rtype == LOG_REC_ERRCOAL)
+        else:
+            text = "type=%d %s" % (rtype, payload.hex())
+        print("[%s:%d @%u] %s" % (path, count, ts, text))
+        pos = end
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    ex = sub.add_parser("extract")
+    ex.add_argument("elf")
+    ex.add_argument("-o", "--output", default="logfmt.json")
+    de = sub.add_parser("decode")
+    de.add_argument("dict")
+    de.add_argument("logs", nargs="+")
+    args = ap.parse_args()
+
+    if args.cmd == "extract":
+        table = extract(args.elf)
+        with open(args.output, "w", encoding="utf-8") as f:
+            json.dump({"0x%08x" % k: v for k, v in sorted(table.items())}, f, ensure_ascii=False, indent=1)
+        print("%d format strings -> %s" % (len(table), args.output), file=sys.stderr)
+    else:
+        with open(args.dict, encoding="utf-8") as f:
+            table = {int(k, 16): v for k, v in json.load(f).items()}
+        for path in args.logs:
+            decode(table, path)
+
+
+if __name__ == "__main__":
+    main()
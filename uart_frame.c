@@ -0,0 +1,272 @@
+/*
+*********************************************************************************************************
+*
+*   模块名称 : 串口帧解码模块
+*   文件名称 : uart_frame.c
+*   版    本 : V1.0
+*   说    明 : 对循环DMA接收缓冲区逐段输入的字节流做增量解析，帧可以跨越任意多次输入和缓冲区末尾，
+*              解析出的帧以指向接收缓冲区的两段视图交给处理函数，不拷贝数据
+*   修改记录 :
+*       版本号  	日期        作者     	说明
+*       V1.0    2026-10-18 agent     	实现基本功能
+*
+*********************************************************************************************************
+*/
+
+#include <string.h>
+#include "uart_frame.h"
+#include "crc16.h"
+
+enum
+{
+	UART_FRAME_HUNT = 0,
+	UART_FRAME_LEN,
+	UART_FRAME_NLEN,
+	UART_FRAME_DATA,
+	UART_FRAME_CRC_H,
+	UART_FRAME_CRC_L
+};
+
+/*
+***************************************************************************************
+* 函 数 名: UartFrame_Crc16
+* 功能说明: CRC16-CCITT(多项式0x1021)，发送端用0xFFFF作初值计算LEN和PAYLOAD
+* 形   参: crc - 初值；data - 数据；len - 长度
+* 返 回 值: CRC值
+***************************************************************************************
+*/
+u16 UartFrame_Crc16(u16 crc, const u8 *data, u16 len)
+{
+	return Crc16_Calc(crc, data, len);
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _deliver
+* 功能说明: 按负载在缓冲区中的位置生成一段或两段视图，交给处理函数
+* 形   参: dec - 解码器
+* 返 回 值: 无
+***************************************************************************************
+*/
+static void _deliver(UartFrameDec_t *dec)
+{
+	UartFrame_t frame;
+	u16 ps = (u16)((dec->start + 3U) % dec->size);
+
+	frame.p1 = dec->ring + ps;
+	frame.n1 = (u16)(dec->size - ps);
+	if (frame.n1 >= dec->len)
+	{
+		frame.n1 = dec->len;
+		frame.p2 = 0;
+		frame.n2 = 0;
+	}
+	else
+	{
+		frame.p2 = dec->ring;
+		frame.n2 = (u16)(dec->len - frame.n1);
+	}
+
+	dec->stats.frames++;
+	if (dec->handler)
+	{
+		dec->handler(&frame);
+	}
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _resync
+* 功能说明: 放弃当前候选帧，丢掉它的SOF，从下一个字节重新找SOF。候选帧已读的字节仍在
+*          缓冲区中，退回扫描位置即可，数据中间的真实SOF不会被跳过
+* 形   参: dec - 解码器
+* 返 回 值: 无
+***************************************************************************************
+*/
+static void _resync(UartFrameDec_t *dec)
+{
+	u16 next = (u16)((dec->start + 1U) % dec->size);
+
+	dec->pending = (u16)(dec->pending + (dec->scan + dec->size - next) % dec->size);
+	dec->scan = next;
+	dec->state = UART_FRAME_HUNT;
+	dec->stats.resyncs++;
+	dec->stats.skipped++;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: _parse
+* 功能说明: 解析所有已输入的字节
+* 形   参: dec - 解码器
+* 返 回 值: 无
+***************************************************************************************
+*/
+static void _parse(UartFrameDec_t *dec)
+{
+	while (dec->pending > 0U)
+	{
+		u16 pos = dec->scan;
+		u8 b = dec->ring[pos];
+		u8 nb = (u8)(~b & 0xFFU);
+
+		dec->scan = (u16)((pos + 1U == dec->size) ? 0U : pos + 1U);
+		dec->pending--;
+
+		switch (dec->state)
+		{
+		case UART_FRAME_HUNT:
+			if (b == UART_FRAME_SOF)
+			{
+				dec->start = pos;
+				dec->state = UART_FRAME_LEN;
+			}
+			else
+			{
+				dec->stats.skipped++;
+			}
+			break;
+
+		case UART_FRAME_LEN:
+			dec->len = b;
+			dec->state = UART_FRAME_NLEN;
+			break;
+
+		case UART_FRAME_NLEN:
+			if (nb != dec->len
+#if UART_FRAME_MAX_PAYLOAD < 255
+				|| dec->len > UART_FRAME_MAX_PAYLOAD
+#endif
+				)
+			{
+				dec->stats.len_errors++;
+				_resync(dec);
+				break;
+			}
+			dec->crc = Crc16_Byte(0xFFFFU, dec->len);
+			dec->got = 0U;
+			dec->state = (dec->len > 0U) ? UART_FRAME_DATA : UART_FRAME_CRC_H;
+			break;
+
+		case UART_FRAME_DATA:
+			dec->crc = Crc16_Byte(dec->crc, b);
+			if (++dec->got == dec->len)
+			{
+				dec->state = UART_FRAME_CRC_H;
+			}
+			break;
+
+		case UART_FRAME_CRC_H:
+			dec->rx_crc = (u16)(b << 8);
+			dec->state = UART_FRAME_CRC_L;
+			break;
+
+		default:
+			dec->rx_crc |= b;
+			if (dec->rx_crc != dec->crc)
+			{
+				dec->stats.crc_errors++;
+				_resync(dec);
+				break;
+			}
+			dec->state = UART_FRAME_HUNT;
+			_deliver(dec);
+			break;
+		}
+	}
+}
+
+/*
+***************************************************************************************
+* 函 数 名: UartFrame_Init
+* 功能说明: 初始化解码器。候选帧出错时要回头重新扫描，缓冲区至少能放下两个最长帧，
+*          保证回头扫描的字节还没被DMA覆盖
+* 形   参: dec - 解码器；ring - 接收环形缓冲区；size - 缓冲区大小；
+*          pos - 第一次输入数据在缓冲区中的下标；handler - 帧处理函数
+* 返 回 值: 0 表示成功；-1 表示缓冲区太小
+***************************************************************************************
+*/
+int UartFrame_Init(UartFrameDec_t *dec, const u8 *ring, u16 size, u16 pos, UartFrameHandler handler)
+{
+	if (size < 2U * (UART_FRAME_MAX_PAYLOAD + UART_FRAME_OVERHEAD) || pos >= size)
+	{
+		return -1;
+	}
+
+	memset(dec, 0, sizeof(UartFrameDec_t));
+	dec->ring = ring;
+	dec->size = size;
+	dec->end = pos;
+	dec->scan = pos;
+	dec->state = UART_FRAME_HUNT;
+	dec->handler = handler;
+	return 0;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: UartFrame_Reset
+* 功能说明: 丢弃未完成的候选帧和未解析的字节，下一次输入重新找SOF，统计保留
+* 形   参: dec - 解码器
+* 返 回 值: 无
+***************************************************************************************
+*/
+void UartFrame_Reset(UartFrameDec_t *dec)
+{
+	dec->scan = dec->end;
+	dec->pending = 0U;
+	dec->state = UART_FRAME_HUNT;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: UartFrame_Feed
+* 功能说明: 输入一段新收到的连续数据并解析，完整的帧在本函数内交给处理函数。
+*          data不紧接上一次输入时(如接收溢出后跳过了数据)，丢弃未完成的帧并从data处重新开始
+* 形   参: dec - 解码器；data - 数据，必须位于ring内；len - 长度
+* 返 回 值: 0 表示成功；-1 表示数据不在缓冲区内
+***************************************************************************************
+*/
+int UartFrame_Feed(UartFrameDec_t *dec, const u8 *data, u16 len)
+{
+	u16 pos;
+
+	if (data < dec->ring || data + len > dec->ring + dec->size)
+	{
+		return -1;
+	}
+
+	pos = (u16)(data - dec->ring);
+	if (pos != dec->end)
+	{
+		if (dec->state != UART_FRAME_HUNT || dec->pending > 0U)
+		{
+			dec->stats.resyncs++;
+		}
+		dec->end = pos;
+		UartFrame_Reset(dec);
+	}
+
+	dec->end = (u16)((pos + len) % dec->size);
+	dec->pending = (u16)(dec->pending + len);
+	_parse(dec);
+	return 0;
+}
+
+/*
+***************************************************************************************
+* 函 数 名: UartFrame_Copy
+* 功能说明: 把帧负载拷贝到连续的缓冲区，需要在处理函数返回后继续使用负载时调用
+* 形   参: frame - 帧视图；dst - 目标缓冲，至少n1+n2字节
+* 返 回 值: 负载长度
+***************************************************************************************
+*/
+u16 UartFrame_Copy(const UartFrame_t *frame, u8 *dst)
+{
+	memcpy(dst, frame->p1, frame->n1);
+	if (frame->n2 > 0U)
+	{
+		memcpy(dst + frame->n1, frame->p2, frame->n2);
+	}
+	return (u16)(frame->n1 + frame->n2);
+}
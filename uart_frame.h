@@ -0,0 +1,63 @@
+#ifndef __UART_FRAME_H__
+#define __UART_FRAME_H__
+
+#include "types.h"
+
+/*
+ * 帧格式: SOF(0xAA) LEN ~LEN PAYLOAD[LEN] CRC_H CRC_L
+ * CRC为CRC16-CCITT(多项式0x1021，初值0xFFFF)，计算范围为LEN和PAYLOAD，高字节在前。
+ * ~LEN用于尽快识别数据中伪造的SOF，不必等到一整帧长度后才由CRC发现
+ */
+#define UART_FRAME_SOF			0xAA
+
+#ifndef UART_FRAME_MAX_PAYLOAD
+#define UART_FRAME_MAX_PAYLOAD	255
+#endif
+
+#define UART_FRAME_OVERHEAD		5	/*SOF LEN ~LEN CRC_H CRC_L*/
+
+/*一帧的负载，指向接收环形缓冲区，跨过缓冲区末尾时分为两段。只在处理函数内有效*/
+typedef struct
+{
+	const u8 *p1;
+	u16 n1;
+	const u8 *p2;	/*无第二段时为0*/
+	u16 n2;
+} UartFrame_t;
+
+typedef void (*UartFrameHandler)(const UartFrame_t *frame);
+
+typedef struct
+{
+	u32 frames;			/*校验通过的帧数*/
+	u32 crc_errors;		/*CRC错误*/
+	u32 len_errors;		/*LEN与~LEN不符或超过UART_FRAME_MAX_PAYLOAD*/
+	u32 resyncs;		/*放弃候选帧或数据不连续后重新找SOF的次数*/
+	u32 skipped;		/*找SOF时丢弃的字节数*/
+} UartFrameStats_t;
+
+/*流式解码器，解析位置都是环形缓冲区下标，出错时从候选SOF的下一个字节重新扫描，不拷贝数据*/
+typedef struct
+{
+	const u8 *ring;		/*接收环形缓冲区(如DMA循环接收缓冲区)*/
+	u16 size;
+	u16 end;			/*下一次输入数据应在的下标*/
+	u16 scan;			/*下一个待解析字节的下标*/
+	u16 pending;		/*已输入未解析的字节数*/
+	u16 start;			/*候选帧SOF的下标*/
+	u8  state;
+	u8  len;
+	u16 got;
+	u16 crc;
+	u16 rx_crc;
+	UartFrameHandler handler;
+	UartFrameStats_t stats;
+} UartFrameDec_t;
+
+int  UartFrame_Init(UartFrameDec_t *dec, const u8 *ring, u16 size, u16 pos, UartFrameHandler handler);	// 0:OK, -1:缓冲区放不下两帧
+int  UartFrame_Feed(UartFrameDec_t *dec, const u8 *data, u16 len);	// 0:OK, -1:data不在缓冲区内
+void UartFrame_Reset(UartFrameDec_t *dec);
+u16  UartFrame_Copy(const UartFrame_t *frame, u8 *dst);				// 拷贝负载，返回长度
+u16  UartFrame_Crc16(u16 crc, const u8 *data, u16 len);
+
+#endif